@@ -133,3 +133,381 @@ static inline ode_t str2ode(const char* const str)
 			break; \
 	} \
 }
+
+// Single-step macros, for streaming integration (i.e., without storing the whole trajectory)
+//
+// ODESTEP advances the ODE variables x by a single time step h, in place; parameters are as for
+// the ODE macro, except that x need only hold the current state:
+//
+//   	double x[N];
+//   	// ... initialise x
+//   	for (size_t k=1; k<n; ++k) {
+//   		ODESTEP(solver,odefun,x,N,h,...);
+//   		// ... consume x (statistics accumulators, spectral estimators, writers, etc.)
+//   	}
+//
+// produces the same states, step for step, as the ODE macro. For an SDE, add the scaled Wiener
+// increment to x after each step (this corresponds to prefilling x with noise for the ODE macro).
+// No solver name is printed, as the macro is invoked once per time step.
+
+#define ODESTEP(ode,odefun,x,N,h,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			double udot[N]; \
+			odefun(udot,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h*udot[i]; \
+			} \
+			break; \
+		case HEUN: { \
+			const double h2 = h/2.0; \
+			double udot1[N], udot2[N]; \
+			double v[N]; \
+			odefun(udot1,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot1[i]; \
+			odefun(udot2,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h2*(udot1[i]+udot2[i]); \
+			} \
+			break; \
+		case RKFOUR: { \
+			const double h2 = h/2.0; \
+			const double h6 = h/6.0; \
+			double udot1[N],udot2[N],udot3[N],udot4[N]; \
+			double v[N]; \
+			odefun(udot1,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot1[i]; \
+			odefun(udot2,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot2[i]; \
+			odefun(udot3,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot3[i]; \
+			odefun(udot4,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h6*(udot1[i]+2.0*udot2[i]+2.0*udot3[i]+udot4[i]); \
+			} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+// 1-dimensional version of ODESTEP; x is a (modifiable) double, and 'odefun' as for ODE1.
+
+#define ODESTEP1(ode,odefun,x,h,...) \
+{ \
+	switch (ode) { \
+		case EULER: \
+			x += h*odefun(x,__VA_ARGS__); \
+			break; \
+		case HEUN: { \
+			const double udot1 = odefun(x,__VA_ARGS__); \
+			const double udot2 = odefun(x+h*udot1,__VA_ARGS__); \
+			x += (h/2.0)*(udot1+udot2); \
+			} \
+			break; \
+		case RKFOUR: { \
+			const double h2 = h/2.0; \
+			const double udot1 = odefun(x,__VA_ARGS__); \
+			const double udot2 = odefun(x+h2*udot1,__VA_ARGS__); \
+			const double udot3 = odefun(x+h2*udot2,__VA_ARGS__); \
+			const double udot4 = odefun(x+h*udot3,__VA_ARGS__); \
+			x += (h/6.0)*(udot1+2.0*udot2+2.0*udot3+udot4); \
+			} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+// Single- and mixed-precision variants of the ODE and ODE1 macros
+//
+// ODEF and ODE1F are as ODE and ODE1, but with float ODE variables, stages and 'odefun' (i.e., 'odefun'
+// has prototype void (*odefun)(float* const xdot, const float* const x, ...) for ODEF, and
+// float (*odefun)(const float x, ...) for ODE1F), halving memory traffic and doubling SIMD width. Memory
+// for the ODE variables is allocated with
+//
+//   	float* const x = calloc(N*n,sizeof(float));
+//
+// ODEM and ODE1M (mixed precision) take the same float variables and 'odefun', but carry the state from
+// step to step in double precision, rounding only the stored trajectory and the stage arguments to
+// float. The float rounding error of the state update (|h*xdot| is often close to, or below, float
+// resolution relative to |x|) then no longer accumulates over steps, so that accuracy is limited by
+// the float evaluation of 'odefun' rather than by the step count.
+//
+// The step size h may be float or double. As for ODE/ODE1, prefilled noise in x is added to each step.
+
+#define ODE_PREC_(ode,odefun,x,N,n,h,S,A,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			printf("EULER : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			S udot[N]; \
+			A a[N]; \
+			for (size_t i=0; i<N; ++i) a[i] = (A)x[i]; \
+			for (S* u=x; u<x+N*(n-1); u+=N) { \
+				odefun(udot,u,__VA_ARGS__); \
+				S* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) { a[i] += (A)u1[i] + hh*(A)udot[i]; u1[i] = (S)a[i]; } \
+			}} \
+			break; \
+		case HEUN: { \
+			printf("HEUN : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			const A h2 = hh/(A)2; \
+			S udot1[N], udot2[N]; \
+			S v[N]; \
+			A a[N]; \
+			for (size_t i=0; i<N; ++i) a[i] = (A)x[i]; \
+			for (S* u=x; u<x+N*(n-1); u+=N) { \
+				odefun(udot1,u,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = (S)(a[i] + hh*(A)udot1[i]); \
+				odefun(udot2,v,__VA_ARGS__); \
+				S* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) { a[i] += (A)u1[i] + h2*((A)udot1[i]+(A)udot2[i]); u1[i] = (S)a[i]; } \
+			}} \
+			break; \
+		case RKFOUR: { \
+			printf("RK4 : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			const A h2 = hh/(A)2; \
+			const A h6 = hh/(A)6; \
+			S udot1[N],udot2[N],udot3[N],udot4[N]; \
+			S v[N]; \
+			A a[N]; \
+			for (size_t i=0; i<N; ++i) a[i] = (A)x[i]; \
+			for (S* u=x; u<x+N*(n-1); u+=N) { \
+				odefun(udot1,u,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = (S)(a[i] + h2*(A)udot1[i]); \
+				odefun(udot2,v,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = (S)(a[i] + h2*(A)udot2[i]); \
+				odefun(udot3,v,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = (S)(a[i] + hh*(A)udot3[i]); \
+				odefun(udot4,v,__VA_ARGS__); \
+				S* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) { a[i] += (A)u1[i] + h6*((A)udot1[i]+(A)2*(A)udot2[i]+(A)2*(A)udot3[i]+(A)udot4[i]); u1[i] = (S)a[i]; } \
+			}} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#define ODE1_PREC_(ode,odefun,x,n,h,S,A,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			printf("EULER : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			A a = (A)*x; \
+			for (S* u=x; u<x+n-1; ++u) { \
+				const S udot = odefun(*u,__VA_ARGS__); \
+				a += (A)*(u+1) + hh*(A)udot; \
+				*(u+1) = (S)a; \
+			}} \
+			break; \
+		case HEUN: { \
+			printf("HEUN : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			const A h2 = hh/(A)2; \
+			A a = (A)*x; \
+			for (S* u=x; u<x+n-1; ++u) { \
+				const S udot1 = odefun(*u,__VA_ARGS__); \
+				const S udot2 = odefun((S)(a + hh*(A)udot1),__VA_ARGS__); \
+				a += (A)*(u+1) + h2*((A)udot1+(A)udot2); \
+				*(u+1) = (S)a; \
+			}} \
+			break; \
+		case RKFOUR: { \
+			printf("RK4 : "#odefun"\n"); \
+			const A hh = (A)(h); \
+			const A h2 = hh/(A)2; \
+			const A h6 = hh/(A)6; \
+			A a = (A)*x; \
+			for (S* u=x; u<x+n-1; ++u) { \
+				const S udot1 = odefun(*u,__VA_ARGS__); \
+				const S udot2 = odefun((S)(a + h2*(A)udot1),__VA_ARGS__); \
+				const S udot3 = odefun((S)(a + h2*(A)udot2),__VA_ARGS__); \
+				const S udot4 = odefun((S)(a + hh*(A)udot3),__VA_ARGS__); \
+				a += (A)*(u+1) + h6*((A)udot1+(A)2*(A)udot2+(A)2*(A)udot3+(A)udot4); \
+				*(u+1) = (S)a; \
+			}} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#define ODEF(ode,odefun,x,N,n,h,...)  ODE_PREC_(ode,odefun,x,N,n,h,float,float,__VA_ARGS__)
+#define ODEM(ode,odefun,x,N,n,h,...)  ODE_PREC_(ode,odefun,x,N,n,h,float,double,__VA_ARGS__)
+#define ODE1F(ode,odefun,x,n,h,...)   ODE1_PREC_(ode,odefun,x,n,h,float,float,__VA_ARGS__)
+#define ODE1M(ode,odefun,x,n,h,...)   ODE1_PREC_(ode,odefun,x,n,h,float,double,__VA_ARGS__)
+
+// Non-autonomous (time-dependent) variants
+//
+// ODET and ODE1T are as ODE and ODE1, with an additional parameter t0 (the time of the initial state,
+// type const double), and with 'odefun' taking the time as its second parameter:
+//
+//   	void   (*odefun)(double* const xdot, const double t, const double* const x, ...)   // ODET
+//   	double (*odefun)(const double t, const double x, ...)                             // ODE1T
+//
+// so that forcing terms may be computed on the fly, rather than precomputed into arrays of length n.
+// Stages are evaluated at their correct times t+c_i*h (Euler: c = 0; Heun: c = 0, 1; RK4: c = 0, 1/2,
+// 1/2, 1), where the time of step k is computed as t = t0+k*h (no accumulated rounding).
+//
+// ODESTEPT and ODESTEP1T are the corresponding single-step macros, advancing x from time t to t+h.
+
+#define ODET(ode,odefun,x,N,n,h,t0,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			printf("EULER : "#odefun"\n"); \
+			double udot[N]; \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				double* const u = x+N*k; \
+				odefun(udot,t,u,__VA_ARGS__); \
+				double* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) u1[i] += u[i] + h*udot[i]; \
+			}} \
+			break; \
+		case HEUN: { \
+			printf("HEUN : "#odefun"\n"); \
+			const double h2 = h/2.0; \
+			double udot1[N], udot2[N]; \
+			double v[N]; \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				double* const u = x+N*k; \
+				odefun(udot1,t,u,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = u[i] + h*udot1[i]; \
+				odefun(udot2,t+h,v,__VA_ARGS__); \
+				double* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) u1[i] += u[i] + h2*(udot1[i]+udot2[i]); \
+			}} \
+			break; \
+		case RKFOUR: { \
+			printf("RK4 : "#odefun"\n"); \
+			const double h2 = h/2.0; \
+			const double h6 = h/6.0; \
+			double udot1[N],udot2[N],udot3[N],udot4[N]; \
+			double v[N]; \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				double* const u = x+N*k; \
+				odefun(udot1,t,u,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = u[i] + h2*udot1[i]; \
+				odefun(udot2,t+h2,v,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = u[i] + h2*udot2[i]; \
+				odefun(udot3,t+h2,v,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) v[i] = u[i] + h*udot3[i]; \
+				odefun(udot4,t+h,v,__VA_ARGS__); \
+				double* const u1 = u+N; \
+				for (size_t i=0; i<N; ++i) u1[i]  += u[i] + h6*(udot1[i]+2.0*udot2[i]+2.0*udot3[i]+udot4[i]); \
+			}} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#define ODE1T(ode,odefun,x,n,h,t0,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			printf("EULER : "#odefun"\n"); \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				x[k+1] += x[k] + h*odefun(t,x[k],__VA_ARGS__); \
+			}} \
+			break; \
+		case HEUN: { \
+			printf("HEUN : "#odefun"\n"); \
+			const double h2 = h/2.0; \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				const double udot1 = odefun(t,x[k],__VA_ARGS__); \
+				const double udot2 = odefun(t+h,x[k]+h*udot1,__VA_ARGS__); \
+				x[k+1] += x[k] + h2*(udot1+udot2); \
+			}} \
+			break; \
+		case RKFOUR: { \
+			printf("RK4 : "#odefun"\n"); \
+			const double h2 = h/2.0; \
+			const double h6 = h/6.0; \
+			for (size_t k=0; k<n-1; ++k) { \
+				const double t = t0+(double)k*h; \
+				const double udot1 = odefun(t,   x[k],__VA_ARGS__); \
+				const double udot2 = odefun(t+h2,x[k]+h2*udot1,__VA_ARGS__); \
+				const double udot3 = odefun(t+h2,x[k]+h2*udot2,__VA_ARGS__); \
+				const double udot4 = odefun(t+h, x[k]+h*udot3,__VA_ARGS__); \
+				x[k+1] += x[k] + h6*(udot1+2.0*udot2+2.0*udot3+udot4); \
+			}} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#define ODESTEPT(ode,odefun,x,N,t,h,...) \
+{ \
+	switch (ode) { \
+		case EULER: { \
+			double udot[N]; \
+			odefun(udot,t,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h*udot[i]; \
+			} \
+			break; \
+		case HEUN: { \
+			const double h2 = h/2.0; \
+			double udot1[N], udot2[N]; \
+			double v[N]; \
+			odefun(udot1,t,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot1[i]; \
+			odefun(udot2,t+h,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h2*(udot1[i]+udot2[i]); \
+			} \
+			break; \
+		case RKFOUR: { \
+			const double h2 = h/2.0; \
+			const double h6 = h/6.0; \
+			double udot1[N],udot2[N],udot3[N],udot4[N]; \
+			double v[N]; \
+			odefun(udot1,t,x,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot1[i]; \
+			odefun(udot2,t+h2,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot2[i]; \
+			odefun(udot3,t+h2,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot3[i]; \
+			odefun(udot4,t+h,v,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h6*(udot1[i]+2.0*udot2[i]+2.0*udot3[i]+udot4[i]); \
+			} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#define ODESTEP1T(ode,odefun,x,t,h,...) \
+{ \
+	switch (ode) { \
+		case EULER: \
+			x += h*odefun(t,x,__VA_ARGS__); \
+			break; \
+		case HEUN: { \
+			const double udot1 = odefun(t,x,__VA_ARGS__); \
+			const double udot2 = odefun(t+h,x+h*udot1,__VA_ARGS__); \
+			x += (h/2.0)*(udot1+udot2); \
+			} \
+			break; \
+		case RKFOUR: { \
+			const double h2 = h/2.0; \
+			const double udot1 = odefun(t,x,__VA_ARGS__); \
+			const double udot2 = odefun(t+h2,x+h2*udot1,__VA_ARGS__); \
+			const double udot3 = odefun(t+h2,x+h2*udot2,__VA_ARGS__); \
+			const double udot4 = odefun(t+h,x+h*udot3,__VA_ARGS__); \
+			x += (h/6.0)*(udot1+2.0*udot2+2.0*udot3+udot4); \
+			} \
+			break; \
+		default: \
+			break; \
+	} \
+}
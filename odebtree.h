@@ -0,0 +1,161 @@
+#ifndef ODEBTREE_H
+#define ODEBTREE_H
+
+// Brownian tree: a seeded, reproducible N-dimensional Wiener process on [t0,t1] that may be queried at
+// arbitrary times, for adaptive or multilevel SDE stepping
+//
+// When SDE steps are adapted (rejected and retried with a smaller step) or refined (multilevel Monte
+// Carlo), the noise must be consistent: the increment over a half step must be a Brownian bridge sample
+// conditioned on the increment over the full step. Rather than storing all increments, W is defined by
+// a virtual binary tree over [t0,t1]: W(t1) is drawn from the root seed, and the value at the midpoint of
+// each node interval is drawn from the bridge between its end-point values, with a normal variate
+// generated from the node's seed (derived by hashing from its parent's). W(t) is found by descending from
+// the root to depth L (intervals of length <= tol), then interpolating linearly; so any query, in any
+// order, gives the same value for the same seed, at cost O(L) = O(log((t1-t0)/tol)).
+//
+// The path from the root to the most recent query is cached (O(L) memory), and a query resumes from the
+// deepest cached interval containing it, so that a query at distance h from the last descends only
+// about log2(h/tol) levels; the value at the last query is also kept, so that for successive steps only
+// the step end is evaluated. E.g., an SDE step of size h at time t, with additive noise sig:
+//
+//   	obt_t b;
+//   	obt_init(&b,N,t0,t1,tol,seed);
+//   	double dw[N];
+//   	// ...
+//   	ODESTEP(solver,odefun,x,N,h,...);
+//   	obt_incr(&b,t,t+h,dw);               // W(t+h)-W(t): the same for any later refinement of [t,t+h]
+//   	for (size_t i=0; i<N; ++i) x[i] += sig*dw[i];
+//   	// ...
+//   	obt_free(&b);
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define OBT_MAXDEPTH 60
+
+typedef struct {
+	size_t    N;     // number of variables
+	double    t0;    // start time
+	double    t1;    // end time
+	unsigned  L;     // tree depth
+	unsigned  depth; // deepest cached level
+	double*   lo;    // cached interval lower ends (L+1)
+	double*   hi;    // cached interval upper ends (L+1)
+	uint64_t* key;   // cached node seeds (L+1)
+	double*   W;     // cached W at interval ends ((L+1) x 2N: lower, upper)
+	double    tq;    // time of the last query
+	double*   wq;    // W at the last query (N)
+	size_t    nz;    // normal variates generated
+} obt_t;
+
+// Seed hashing (splitmix64 finaliser)
+
+static inline uint64_t obt_hash(uint64_t z)
+{
+	z += 0x9e3779b97f4a7c15;
+	z = (z^(z>>30))*0xbf58476d1ce4e5b9;
+	z = (z^(z>>27))*0x94d049bb133111eb;
+	return z^(z>>31);
+}
+
+// Standard normal variate i of node key (Box-Muller on two hashed uniforms in (0,1))
+
+static inline double obt_normal(const uint64_t key, const size_t i)
+{
+	const uint64_t h1 = obt_hash(key^(0xd1b54a32d192ed03*(2*(uint64_t)i+1)));
+	const uint64_t h2 = obt_hash(h1);
+	const double u1 = ((double)(h1>>11)+0.5)*(1.0/9007199254740992.0);
+	const double u2 = (double)(h2>>11)*(1.0/9007199254740992.0);
+	return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+
+static inline void obt_free(obt_t* const b)
+{
+	free(b->lo);
+	b->lo = b->hi = b->W = b->wq = NULL;
+	b->key = NULL;
+}
+
+// Wiener process on [t0,t1], resolved to intervals of length tol (linear interpolation below)
+
+static inline int obt_init(obt_t* const b, const size_t N, const double t0, const double t1, const double tol, const uint64_t seed)
+{
+	unsigned L = 0;
+	while (L < OBT_MAXDEPTH && (t1-t0)/(double)((uint64_t)1<<L) > tol) ++L;
+	b->N     = N;
+	b->t0    = t0;
+	b->t1    = t1;
+	b->L     = L;
+	b->depth = 0;
+	b->nz    = 0;
+	b->lo    = malloc(((L+1)*(3+2*N)+N)*sizeof(double)); // lo, hi, key, W, wq
+	if (b->lo == NULL) return -1;
+	b->hi    = b->lo+(L+1);
+	b->key   = (uint64_t*)(b->hi+(L+1));
+	b->W     = (double*)(b->key+(L+1));
+	b->wq    = b->W+2*N*(L+1);
+	b->tq    = t0;
+	b->lo[0]  = t0;
+	b->hi[0]  = t1;
+	b->key[0] = obt_hash(seed);
+	const double sT = sqrt(t1-t0);
+	for (size_t i=0; i<N; ++i) {
+		b->W[i]   = 0.0;
+		b->W[N+i] = sT*obt_normal(obt_hash(b->key[0]),i); // W(t1)
+		b->wq[i]  = 0.0;
+	}
+	b->nz = N;
+	return 0;
+}
+
+// W(t) into w[0 .. N-1] (t is clamped to [t0,t1])
+
+static inline void obt_eval(obt_t* const b, const double t, double* const w)
+{
+	const size_t N = b->N;
+	const double s = t < b->t0 ? b->t0 : t > b->t1 ? b->t1 : t;
+	if (s == b->tq) { // repeated query (e.g. start of a step at the end of the last)
+		memcpy(w,b->wq,N*sizeof(double));
+		return;
+	}
+	unsigned d = b->depth;
+	while (d > 0 && !(b->lo[d] <= s && s <= b->hi[d])) --d; // deepest cached interval containing s
+	for (; d<b->L; ++d) { // descend: bridge value at the midpoint
+		const double l = b->lo[d], r = b->hi[d], m = 0.5*(l+r), sd = sqrt(0.25*(r-l));
+		const double* const Wd = b->W+2*N*d;
+		double* const Wc = b->W+2*N*(d+1);
+		const int right = s > m;
+		for (size_t i=0; i<N; ++i) {
+			const double wm = 0.5*(Wd[i]+Wd[N+i])+sd*obt_normal(b->key[d],i);
+			Wc[i]   = right ? wm : Wd[i];
+			Wc[N+i] = right ? Wd[N+i] : wm;
+		}
+		b->nz += N;
+		b->lo[d+1]  = right ? m : l;
+		b->hi[d+1]  = right ? r : m;
+		b->key[d+1] = obt_hash(b->key[d]^(right ? 0xa0761d6478bd642f : 0xe7037ed1a0b428db));
+	}
+	b->depth = b->L;
+	const double* const WL = b->W+2*N*b->L;
+	const double l = b->lo[b->L], r = b->hi[b->L], th = r > l ? (s-l)/(r-l) : 0.0;
+	for (size_t i=0; i<N; ++i) w[i] = WL[i]+th*(WL[N+i]-WL[i]);
+	b->tq = s;
+	memcpy(b->wq,w,N*sizeof(double));
+}
+
+// Increment W(tb)-W(ta) into dw[0 .. N-1]
+
+static inline void obt_incr(obt_t* const b, const double ta, const double tb, double* const dw)
+{
+	const size_t N = b->N;
+	double wa[N];
+	obt_eval(b,ta,wa);
+	obt_eval(b,tb,dw);
+	for (size_t i=0; i<N; ++i) dw[i] -= wa[i];
+}
+
+#endif // ODEBTREE_H
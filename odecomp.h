@@ -0,0 +1,223 @@
+#ifndef ODECOMP_H
+#define ODECOMP_H
+
+// Lossless predictive XOR compression of trajectories (trajectory file value type OTRJ_XORPRED, see
+// odetrj.h)
+//
+// Each value is predicted from the previous values of the same variable by the best of four
+// polynomial extrapolations (constant, linear, quadratic, cubic), and the XOR of the prediction with the
+// actual value (as 64-bit patterns) is stored with its leading zero bits removed:
+//
+// Field      Bits                Description
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+// selector   2                   predictor: 0 = constant, 1 = linear, 2 = quadratic, 3 = cubic
+// lz         6                   leading zero bits of the XOR residual, z = min(lz,63)
+// residual   64-z                remaining bits of the XOR residual
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+//
+// packed most-significant bit first into 64-bit words. Smooth trajectories yield long runs of leading
+// zeros (matching sign, exponent and high mantissa bits). Predictions are computed in plain IEEE double
+// arithmetic, and decoding must reproduce them bit for bit, in any build: do not compile with -ffast-math
+// (or -fassociative-math). The predictors are written with additions and power-of-two multiples only, so
+// that floating-point contraction (fused multiply-add, which gcc applies by default, -ffp-contract=fast)
+// cannot change their rounding; keep it that way when adding predictors.
+//
+// Blocks of rows are compressed independently (predictor history restarts at each block), so they may
+// be decoded separately. In a file each block is preceded by its row count and payload length in
+// 64-bit words (both uint64_t). ow_xorpred is a block function for the asynchronous writer (odewrite.h).
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// Maximum payload words for a block of rows x N values (2+6+64 bits per value, worst case)
+
+static inline size_t ocomp_bound(const size_t rows, const size_t N)
+{
+	return (72*rows*N+63)/64;
+}
+
+static inline uint64_t ocomp_bits(const double x)
+{
+	uint64_t u;
+	memcpy(&u,&x,sizeof(u));
+	return u;
+}
+
+static inline double ocomp_double(const uint64_t u)
+{
+	double x;
+	memcpy(&x,&u,sizeof(x));
+	return x;
+}
+
+static inline unsigned ocomp_lz(const uint64_t r)
+{
+	return r == 0 ? 64 : (unsigned)__builtin_clzll(r);
+}
+
+// Predictions from the four previous values a, b, c, d (most recent first): a, 2a-b, 3(a-b)+c and
+// 4(a+c)-6b-d. Multiples are formed by doubling and one addition (2x+x rounds as 3x, 4x+2x as 6x), so
+// the results equal the plain products, and are unaffected by contraction into fused multiply-adds
+// (which are exact for the power-of-two multiples).
+
+#define OCOMP_PREDICT(p,a,b,c,d) \
+{ \
+	const double d1_ = (a)-(b), s1_ = (a)+(c); \
+	const double b2_ = (b)+(b), d2_ = d1_+d1_, s2_ = s1_+s1_; \
+	p[0] = ocomp_bits(a); \
+	p[1] = ocomp_bits(((a)+(a))-(b)); \
+	p[2] = ocomp_bits((d2_+d1_)+(c)); \
+	p[3] = ocomp_bits((s2_+s2_)-(b2_+b2_+b2_)-(d)); \
+}
+
+// Compress a block of rows x N values (row-major) to out (at least ocomp_bound(rows,N) words); returns
+// the number of words written
+
+static inline size_t ocomp_encode(const double* const blk, const size_t rows, const size_t N, uint64_t* const out)
+{
+	uint64_t* w = out;
+	uint64_t acc = 0;    // bit accumulator
+	unsigned nacc = 0;   // bits in accumulator
+#define OCOMP_PUT(v,nb) \
+	{ \
+		const unsigned nb_ = (nb); \
+		if (nb_ > 0) { \
+			const uint64_t v_ = nb_ == 64 ? (v) : (v) & ((UINT64_C(1)<<nb_)-1); \
+			const unsigned f_ = 64-nacc; \
+			if (nb_ < f_) { \
+				acc = (acc<<nb_)|v_; \
+				nacc += nb_; \
+			} \
+			else { \
+				*w++ = f_ == 64 ? v_ : (acc<<f_)|(v_>>(nb_-f_)); \
+				nacc = nb_-f_; \
+				acc = nacc == 0 ? 0 : v_ & ((UINT64_C(1)<<nacc)-1); \
+			} \
+		} \
+	}
+	for (size_t k=0; k<rows; ++k) {
+		const double* const x  = blk+N*k;
+		const double* const x1 = k > 0 ? x-N   : NULL;
+		const double* const x2 = k > 1 ? x-2*N : NULL;
+		const double* const x3 = k > 2 ? x-3*N : NULL;
+		const double* const x4 = k > 3 ? x-4*N : NULL;
+		for (size_t i=0; i<N; ++i) {
+			const double a = x1 ? x1[i] : 0.0;
+			const double b = x2 ? x2[i] : 0.0;
+			const double c = x3 ? x3[i] : 0.0;
+			const double d = x4 ? x4[i] : 0.0;
+			uint64_t p[4];
+			OCOMP_PREDICT(p,a,b,c,d);
+			const uint64_t u = ocomp_bits(x[i]);
+			unsigned sel = 0, lz = ocomp_lz(u^p[0]);
+			for (unsigned s=1; s<4; ++s) {
+				const unsigned lzs = ocomp_lz(u^p[s]);
+				if (lzs > lz) {
+					sel = s;
+					lz  = lzs;
+				}
+			}
+			const unsigned z = lz < 63 ? lz : 63;
+			OCOMP_PUT((uint64_t)((sel<<6)|z),8);
+			OCOMP_PUT(u^p[sel],64-z);
+		}
+	}
+#undef OCOMP_PUT
+	if (nacc > 0) *w++ = acc<<(64-nacc);
+	return (size_t)(w-out);
+}
+
+// Decompress a block of rows x N values
+
+static inline void ocomp_decode(const uint64_t* const in, const size_t rows, const size_t N, double* const blk)
+{
+	const uint64_t* w = in;
+	uint64_t cur = 0;  // current word
+	unsigned left = 0; // unread bits in current word
+#define OCOMP_GET(v,nb) \
+	{ \
+		const unsigned nb_ = (nb); \
+		if (nb_ == 0) { \
+			v = 0; \
+		} \
+		else if (nb_ <= left) { \
+			v = nb_ == 64 ? cur : (cur>>(left-nb_)) & ((UINT64_C(1)<<nb_)-1); \
+			left -= nb_; \
+		} \
+		else { \
+			const unsigned r_ = nb_-left; \
+			const uint64_t hi_ = left == 0 ? 0 : cur & ((UINT64_C(1)<<left)-1); \
+			cur = *w++; \
+			v = (r_ == 64 ? 0 : hi_<<r_)|(cur>>(64-r_)); \
+			left = 64-r_; \
+		} \
+	}
+	for (size_t k=0; k<rows; ++k) {
+		double* const x  = blk+N*k;
+		const double* const x1 = k > 0 ? x-N   : NULL;
+		const double* const x2 = k > 1 ? x-2*N : NULL;
+		const double* const x3 = k > 2 ? x-3*N : NULL;
+		const double* const x4 = k > 3 ? x-4*N : NULL;
+		for (size_t i=0; i<N; ++i) {
+			const double a = x1 ? x1[i] : 0.0;
+			const double b = x2 ? x2[i] : 0.0;
+			const double c = x3 ? x3[i] : 0.0;
+			const double d = x4 ? x4[i] : 0.0;
+			uint64_t p[4], code, r;
+			OCOMP_PREDICT(p,a,b,c,d);
+			OCOMP_GET(code,8);
+			const unsigned sel = (unsigned)(code>>6);
+			const unsigned z   = (unsigned)(code&63);
+			OCOMP_GET(r,64-z);
+			x[i] = ocomp_double(r^p[sel]);
+		}
+	}
+#undef OCOMP_GET
+}
+
+// Compressor workspace (for a maximum of B rows per block)
+
+typedef struct {
+	size_t    cap; // capacity (words)
+	uint64_t* buf; // compressed block
+} ocomp_t;
+
+static inline int ocomp_init(ocomp_t* const c, const size_t B, const size_t N)
+{
+	c->cap = ocomp_bound(B,N);
+	c->buf = malloc(c->cap*sizeof(uint64_t));
+	return c->buf == NULL ? -1 : 0;
+}
+
+static inline void ocomp_free(ocomp_t* const c)
+{
+	free(c->buf);
+	c->buf = NULL;
+}
+
+// Compress and write a block (asynchronous writer block function; arg is an ocomp_t*)
+
+static inline int ow_xorpred(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+{
+	ocomp_t* const c = arg;
+	const uint64_t hdr[2] = {rows,ocomp_encode(blk,rows,N,c->buf)};
+	if (fwrite(hdr,sizeof(uint64_t),2,fs) != 2) return -1;
+	return fwrite(c->buf,sizeof(uint64_t),hdr[1],fs) == hdr[1] ? 0 : -1;
+}
+
+// Read and decompress the next block into blk (room for at least maxrows rows); returns the number of
+// rows, 0 at end of file, or -1 on error (errno may be set)
+
+static inline long ocomp_fread(FILE* const fs, ocomp_t* const c, double* const blk, const size_t maxrows, const size_t N)
+{
+	uint64_t hdr[2];
+	if (fread(hdr,sizeof(uint64_t),2,fs) != 2) return feof(fs) ? 0 : -1;
+	if (hdr[0] > maxrows || hdr[1] > c->cap) return -1;
+	if (fread(c->buf,sizeof(uint64_t),hdr[1],fs) != hdr[1]) return -1;
+	ocomp_decode(c->buf,hdr[0],N,blk);
+	return (long)hdr[0];
+}
+
+#endif // ODECOMP_H
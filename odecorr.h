@@ -0,0 +1,160 @@
+#ifndef ODECORR_H
+#define ODECORR_H
+
+// Streaming multi-tau auto- and cross-correlator, fed one state at a time from the integration loop
+// (see ODESTEP in ode.h).
+//
+// Multi-tau (block-averaging) scheme: level 0 correlates the raw samples at lags 0 .. p-1 steps; each
+// further level correlates m-sample block averages of the level below, at lags (p/m .. p-1)*m^l steps.
+// Lags are thus logarithmically spaced, and a maximum lag of T steps needs only O(p*log(T)) memory
+// and O(p) amortised work per step and correlated pair. At level l > 0 correlations are of block
+// averages, which is a good approximation at lags large compared with the block length m^l.
+//
+// The correlation for the pair (a,b) at lag k is the time average of x_a(t)*x_b(t+k); covariances
+// (with the overall means subtracted) may also be returned.
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails or the arguments are
+// invalid (errno is set).
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+typedef struct {
+	size_t  N;    // number of variables
+	size_t  P;    // number of correlated pairs
+	size_t  p;    // lags per level (multiple of m)
+	size_t  m;    // block-averaging factor
+	size_t  S;    // number of levels
+	size_t  n;    // number of samples
+	size_t* pa;   // first  variable of each pair
+	size_t* pb;   // second variable of each pair
+	size_t* pos;  // per level: shift register slot of newest value
+	size_t* nin;  // per level: number of values in shift register (up to p)
+	size_t* nacc; // per level: number of values in block accumulator
+	size_t* cnt;  // correlation counts (S x p)
+	double* D;    // shift registers (S x p x N)
+	double* A;    // block accumulators (S x N)
+	double* C;    // correlation sums (S x p x P)
+	double* sum;  // sums of raw samples (N)
+} ocorr_t;
+
+// Initialise for N variables and P pairs given by pairs[2*q], pairs[2*q+1] (variables numbered from
+// zero); if pairs is NULL, P is ignored and the N autocorrelations are computed. Levels are added until
+// the maximum lag is at least maxlag steps. Requires m >= 2 and p a multiple of m (else EINVAL).
+
+static inline int ocorr_init(ocorr_t* const c, const size_t N, const size_t* const pairs, const size_t P, const size_t p, const size_t m, const size_t maxlag)
+{
+	memset(c,0,sizeof(ocorr_t));
+	if (m < 2 || p < m || p%m != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	c->N = N;
+	c->P = pairs == NULL ? N : P;
+	c->p = p;
+	c->m = m;
+	c->S = 1;
+	for (size_t lmax=p-1; lmax < maxlag; lmax *= m) ++c->S;
+	const size_t S = c->S;
+	c->pa = malloc((2*c->P+3*S+S*p)*sizeof(size_t));
+	c->D  = calloc(S*p*N+S*N+S*p*c->P+N,sizeof(double));
+	if (c->pa == NULL || c->D == NULL) {
+		free(c->pa);
+		free(c->D);
+		return -1;
+	}
+	c->pb   = c->pa+c->P;
+	c->pos  = c->pb+c->P;
+	c->nin  = c->pos+S;
+	c->nacc = c->nin+S;
+	c->cnt  = c->nacc+S;
+	memset(c->pos,0,(3*S+S*p)*sizeof(size_t));
+	for (size_t q=0; q<c->P; ++q) {
+		c->pa[q] = pairs == NULL ? q : pairs[2*q];
+		c->pb[q] = pairs == NULL ? q : pairs[2*q+1];
+	}
+	c->A   = c->D+S*p*N;
+	c->C   = c->A+S*N;
+	c->sum = c->C+S*p*c->P;
+	return 0;
+}
+
+static inline void ocorr_free(ocorr_t* const c)
+{
+	free(c->pa);
+	free(c->D);
+	c->pa = c->pb = c->pos = c->nin = c->nacc = c->cnt = NULL;
+	c->D  = c->A  = c->C   = c->sum = NULL;
+}
+
+// Feed the current state x (length N)
+
+static inline void ocorr_update(ocorr_t* const c, const double* const x)
+{
+	const size_t N = c->N, P = c->P, p = c->p, m = c->m;
+	for (size_t i=0; i<N; ++i) c->sum[i] += x[i];
+	++c->n;
+	const double* y = x;
+	for (size_t l=0; l<c->S; ++l) {
+		double* const Dl = c->D+p*N*l;
+		c->pos[l] = c->pos[l] == 0 ? p-1 : c->pos[l]-1;
+		double* const y0 = Dl+N*c->pos[l]; // newest value
+		memcpy(y0,y,N*sizeof(double));
+		if (l > 0) memset(c->A+N*(l-1),0,N*sizeof(double)); // y was the block accumulator of the level below
+		if (c->nin[l] < p) ++c->nin[l];
+		double* const Cl = c->C+p*P*l;
+		size_t* const nl = c->cnt+p*l;
+		for (size_t j = l == 0 ? 0 : p/m, s = (c->pos[l]+j)%p; j<c->nin[l]; ++j, s = s+1 == p ? 0 : s+1) {
+			const double* const yj = Dl+N*s; // value j steps (at this level) older
+			double* const Clj = Cl+P*j;
+			for (size_t q=0; q<P; ++q) Clj[q] += yj[c->pa[q]]*y0[c->pb[q]];
+			++nl[j];
+		}
+		double* const Al = c->A+N*l;
+		for (size_t i=0; i<N; ++i) Al[i] += y0[i];
+		if (++c->nacc[l] < m) break;
+		c->nacc[l] = 0;
+		if (l+1 == c->S) { // top-level block average is discarded
+			memset(Al,0,N*sizeof(double));
+			break;
+		}
+		const double rm = 1.0/(double)m;
+		for (size_t i=0; i<N; ++i) Al[i] *= rm;
+		y = Al; // block average passed to next level
+	}
+}
+
+// Maximum number of lags returned by ocorr_get
+
+static inline size_t ocorr_nlags(const ocorr_t* const c)
+{
+	return c->p+(c->S-1)*(c->p-c->p/c->m);
+}
+
+// Get lags (in integration steps) and correlations (nlags x P, row-major); if centred is non-zero,
+// overall means are subtracted, yielding covariances. Returns the number of lags with data.
+
+static inline size_t ocorr_get(const ocorr_t* const c, size_t* const lag, double* const corr, const int centred)
+{
+	const size_t P = c->P, p = c->p;
+	const double rn = 1.0/(double)c->n;
+	size_t K = 0;
+	for (size_t l=0, ml=1; l<c->S; ++l, ml *= c->m) {
+		for (size_t j = l == 0 ? 0 : p/c->m; j<p; ++j) {
+			const size_t nj = c->cnt[p*l+j];
+			if (nj == 0) continue;
+			lag[K] = j*ml;
+			const double* const Clj = c->C+p*P*l+P*j;
+			double* const r = corr+P*K;
+			for (size_t q=0; q<P; ++q) {
+				r[q] = Clj[q]/(double)nj;
+				if (centred) r[q] -= rn*rn*c->sum[c->pa[q]]*c->sum[c->pb[q]];
+			}
+			++K;
+		}
+	}
+	return K;
+}
+
+#endif // ODECORR_H
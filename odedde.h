@@ -0,0 +1,216 @@
+#ifndef ODEDDE_H
+#define ODEDDE_H
+
+// Delay differential equations (DDEs), with constant or state-dependent delays
+//
+// The history needed for delayed terms is kept in a ring buffer of the most recent H = ceil(taumax/h)+3
+// steps (state and derivative at each step), so that memory is bounded by the maximum delay taumax
+// rather than by the run length. Delayed states at arbitrary times (stage times minus delays) are
+// obtained by cubic Hermite (dense) interpolation between steps, which is accurate to O(h^4); times
+// before the initial time t0 are evaluated from the initial history function phi.
+//
+// The DDE function has the same form as for ODESTEPT (see ode.h), with the history as an additional
+// parameter, through which delayed states are obtained with odde_lag (a single variable) or odde_lagv
+// (all variables). E.g., for x'(t) = -x(t-tau):
+//
+//   	static inline void delayed(double* const xdot, const double t, const double* const x, odde_t* const d, const double tau)
+//   	{
+//   		xdot[0] = -odde_lag(d,t-tau,0);
+//   	}
+//
+//   	odde_t d;
+//   	odde_init(&d,N,taumax,h,t0,phi,phiarg); // initial state x = phi(t0)
+//   	double x[N];
+//   	phi(t0,x,phiarg);
+//   	for (size_t k=1; k<n; ++k) {
+//   		DDESTEP(solver,delayed,x,N,h,&d,tau);
+//   		// ... consume x (time t0+k*h)
+//   	}
+//   	odde_free(&d);
+//
+// For full accuracy delays should be at least h (otherwise a delayed time may fall within the current
+// step, and is extrapolated from the most recent complete step). Delayed times further back than
+// taumax (plus a step) are clamped to the oldest history available, and counted in 'nfar'.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef void (*odde_phi_t)(const double t, double* const x, void* const arg);
+
+typedef struct {
+	size_t     N;    // number of variables
+	size_t     H;    // history length (steps)
+	double     h;    // integration step size
+	double     t0;   // initial time
+	size_t     n;    // steps pushed to the history
+	int        fk;   // derivative of the most recent step known?
+	double*    x;    // state history (ring buffer, H x N)
+	double*    f;    // derivative history (ring buffer, H x N)
+	odde_phi_t phi;  // initial history function (t <= t0)
+	void*      arg;  // initial history function argument
+	size_t     nfar; // delayed times beyond the history
+} odde_t;
+
+// Set up history for delays up to taumax; returns 0 on success, -1 on failure
+
+static inline int odde_init(odde_t* const d, const size_t N, const double taumax, const double h, const double t0, const odde_phi_t phi, void* const arg)
+{
+	memset(d,0,sizeof(odde_t));
+	d->N   = N;
+	d->H   = (size_t)ceil(taumax/h)+3;
+	d->h   = h;
+	d->t0  = t0;
+	d->phi = phi;
+	d->arg = arg;
+	d->x   = malloc(2*d->H*N*sizeof(double));
+	if (d->x == NULL) return -1;
+	d->f   = d->x+d->H*N;
+	return 0;
+}
+
+static inline void odde_free(odde_t* const d)
+{
+	free(d->x);
+	d->x = d->f = NULL;
+}
+
+// Time of the next step to be pushed (i.e., of the current state)
+
+static inline double odde_time(const odde_t* const d)
+{
+	return d->t0+(double)d->n*d->h;
+}
+
+// Push the current state (derivative to follow, see odde_setdot)
+
+static inline void odde_push(odde_t* const d, const double* const x)
+{
+	memcpy(d->x+d->N*(d->n%d->H),x,d->N*sizeof(double));
+	++d->n;
+	d->fk = 0;
+}
+
+// Set the derivative at the most recent step (a state must have been pushed)
+
+static inline void odde_setdot(odde_t* const d, const double* const xdot)
+{
+	if (d->n == 0) return;
+	memcpy(d->f+d->N*((d->n-1)%d->H),xdot,d->N*sizeof(double));
+	d->fk = 1;
+}
+
+// Locate the history step j and fractional offset th (in steps) for time s > t0; returns 0 if the
+// history is empty
+
+static inline int odde_locate(odde_t* const d, const double s, size_t* const j, double* const th)
+{
+	if (d->n == 0) return 0;
+	const size_t ncomp = d->fk ? d->n : d->n-1; // steps with known derivative
+	if (ncomp == 0) return 0;
+	const double u = (s-d->t0)/d->h;
+	const size_t jmin = d->n > d->H ? d->n-d->H : 0;
+	const size_t jmax = ncomp > 1 ? ncomp-2 : 0; // last complete segment
+	size_t jj = u < (double)jmax ? (size_t)u : jmax;
+	if (jj < jmin) {
+		jj = jmin;
+		++d->nfar;
+	}
+	*j  = jj;
+	*th = u-(double)jj;
+	if (*th < 0.0) *th = 0.0;
+	return 1;
+}
+
+// Delayed value of variable i at time s
+
+static inline double odde_lag(odde_t* const d, const double s, const size_t i)
+{
+	size_t j;
+	double th;
+	const size_t N = d->N;
+	if (s <= d->t0 || !odde_locate(d,s,&j,&th)) {
+		double y[N];
+		d->phi(s < d->t0 ? s : d->t0,y,d->arg);
+		return y[i];
+	}
+	const size_t a = N*(j%d->H), b = N*((j+1)%d->H);
+	if (j+1 >= d->n || (j+1 == d->n-1 && !d->fk)) { // single step of history: first-order extrapolation
+		return d->x[a+i]+th*d->h*d->f[a+i];
+	}
+	const double th2 = th*th, th3 = th2*th;
+	return (2.0*th3-3.0*th2+1.0)*d->x[a+i]+(th3-2.0*th2+th)*d->h*d->f[a+i]+(3.0*th2-2.0*th3)*d->x[b+i]+(th3-th2)*d->h*d->f[b+i];
+}
+
+// Delayed values of all variables at time s, into y[0 .. N-1]
+
+static inline void odde_lagv(odde_t* const d, const double s, double* const y)
+{
+	size_t j;
+	double th;
+	const size_t N = d->N;
+	if (s <= d->t0 || !odde_locate(d,s,&j,&th)) {
+		d->phi(s < d->t0 ? s : d->t0,y,d->arg);
+		return;
+	}
+	const double* const xa = d->x+N*(j%d->H);
+	const double* const fa = d->f+N*(j%d->H);
+	if (j+1 >= d->n || (j+1 == d->n-1 && !d->fk)) {
+		for (size_t i=0; i<N; ++i) y[i] = xa[i]+th*d->h*fa[i];
+		return;
+	}
+	const double* const xb = d->x+N*((j+1)%d->H);
+	const double* const fb = d->f+N*((j+1)%d->H);
+	const double th2 = th*th, th3 = th2*th;
+	const double c0 = 2.0*th3-3.0*th2+1.0, c1 = (th3-2.0*th2+th)*d->h, c2 = 3.0*th2-2.0*th3, c3 = (th3-th2)*d->h;
+	for (size_t i=0; i<N; ++i) y[i] = c0*xa[i]+c1*fa[i]+c2*xb[i]+c3*fb[i];
+}
+
+// Single DDE step: as ODESTEPT (see ode.h), with the history d (odde_t*) passed to 'odefun' after x;
+// the current state x (at time odde_time(d)) is pushed to the history, and advanced by h in place.
+
+#define DDESTEP(ode,odefun,x,N,h,d,...) \
+{ \
+	const double t_ = odde_time(d); \
+	odde_push(d,x); \
+	switch (ode) { \
+		case EULER: { \
+			double udot[N]; \
+			odefun(udot,t_,x,d,__VA_ARGS__); \
+			odde_setdot(d,udot); \
+			for (size_t i=0; i<N; ++i) x[i] += h*udot[i]; \
+			} \
+			break; \
+		case HEUN: { \
+			const double h2 = h/2.0; \
+			double udot1[N], udot2[N]; \
+			double v[N]; \
+			odefun(udot1,t_,x,d,__VA_ARGS__); \
+			odde_setdot(d,udot1); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot1[i]; \
+			odefun(udot2,t_+h,v,d,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h2*(udot1[i]+udot2[i]); \
+			} \
+			break; \
+		case RKFOUR: { \
+			const double h2 = h/2.0; \
+			const double h6 = h/6.0; \
+			double udot1[N],udot2[N],udot3[N],udot4[N]; \
+			double v[N]; \
+			odefun(udot1,t_,x,d,__VA_ARGS__); \
+			odde_setdot(d,udot1); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot1[i]; \
+			odefun(udot2,t_+h2,v,d,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h2*udot2[i]; \
+			odefun(udot3,t_+h2,v,d,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) v[i] = x[i] + h*udot3[i]; \
+			odefun(udot4,t_+h,v,d,__VA_ARGS__); \
+			for (size_t i=0; i<N; ++i) x[i] += h6*(udot1[i]+2.0*udot2[i]+2.0*udot3[i]+udot4[i]); \
+			} \
+			break; \
+		default: \
+			break; \
+	} \
+}
+
+#endif // ODEDDE_H
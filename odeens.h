@@ -0,0 +1,294 @@
+#ifndef ODEENS_H
+#define ODEENS_H
+
+// Adaptive-step ensemble integration in SIMD batches, with per-lane step sizes and lane refilling
+//
+// An ensemble of M independent trajectories (jobs: initial state, parameters and end time each) is
+// integrated with the Dormand-Prince 5(4) embedded Runge-Kutta pair (FSAL, local extrapolation,
+// standard step size control), B trajectories ("lanes") at a time. The batch state is stored variable-
+// major (x[B*i+l] is variable i of lane l), so that the user RHS and all stage combinations are loops
+// over contiguous lanes, which vectorise.
+//
+// Each lane has its own step size; after each batch step, lanes whose error estimate is too large are
+// masked (their state is left unchanged, and the step retried with a smaller step), so that accepted and
+// rejected lanes proceed together without branches. Since trajectories finish (or diverge) at different
+// times, idle lanes would otherwise waste the batch width; when at least B/4 lanes are idle, they are
+// refilled from the job queue, and once the queue is empty the remaining active lanes are compacted to
+// the front of the batch, and only those (rounded up to OENS_VEC) are computed. With refilling disabled
+// (static batches) each batch runs until its slowest trajectory finishes, for comparison.
+//
+// The RHS is a function over a batch (lanes 0 .. nl-1 must be computed; p holds P parameters per lane,
+// p[B*j+l]), e.g. for the van der Pol oscillator with parameter mu per trajectory:
+//
+//   	static void vdp(double* const xdot, const double* const x, const double* const p, const size_t B, const size_t nl, void* const arg)
+//   	{
+//   		for (size_t l=0; l<nl; ++l) {
+//   			xdot[l]   = x[B+l];
+//   			xdot[B+l] = p[l]*(1.0-x[l]*x[l])*x[B+l]-x[l];
+//   		}
+//   	}
+//
+//   	oens_t e;
+//   	oens_init(&e,N,P,B,rtol,atol);
+//   	oens_run(&e,M,X0,prm,tend,Y,status,vdp,NULL); // X0, Y: M x N; prm: M x P; tend, status: M
+//   	oens_free(&e);
+//
+// Results do not depend on B or on refilling (lanes never interact), so batched runs reproduce
+// single-trajectory (B = 1) runs exactly. The *_init functions return 0 on success, or -1 if memory
+// allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef OENS_VEC
+#define OENS_VEC 4 // lanes per vector (granularity of the computed batch width)
+#endif
+
+typedef void (*oens_fun_t)(double* const xdot, const double* const x, const double* const p, const size_t B, const size_t nl, void* const arg);
+
+typedef enum {OENS_DONE = 0, OENS_DIVERGED, OENS_MAXSTEPS, OENS_HMIN} oens_status_t; // HMIN: step size underflow
+
+typedef struct {
+	size_t  N;       // number of variables
+	size_t  P;       // parameters per trajectory
+	size_t  B;       // lanes per batch
+	double  rtol;    // relative tolerance
+	double  atol;    // absolute tolerance
+	double  h0;      // initial step size
+	double  xmax;    // divergence bound (|x| > xmax, or non-finite)
+	size_t  maxstep; // maximum steps (accepted and rejected) per trajectory
+	int     refill;  // refill idle lanes from the job queue (else static batches)
+	size_t  nbatch;  // batch steps
+	size_t  nlane;   // lane-steps computed
+	size_t  nact;    // lane-steps on active lanes
+	size_t  nacc;    // accepted steps
+	size_t  nrej;    // rejected steps
+	double* x;       // state (N x B)
+	double* xs;      // stage state (N x B)
+	double* k;       // stage derivatives (7 x N x B)
+	double* p;       // parameters (P x B)
+	double* t;       // times (B)
+	double* h;       // step sizes (B)
+	double* tend;    // end times (B)
+	double* err;     // error norms (B)
+	double* w;       // scratch (B)
+	size_t* job;     // job of each lane (B)
+	size_t* nst;     // steps of each lane (B)
+	int*    act;     // lane active? (B)
+} oens_t;
+
+static inline void oens_free(oens_t* const e)
+{
+	free(e->x);
+	free(e->job);
+	free(e->act);
+	e->x = e->xs = e->k = e->p = e->t = e->h = e->tend = e->err = e->w = NULL;
+	e->job = e->nst = NULL;
+	e->act = NULL;
+}
+
+static inline int oens_init(oens_t* const e, const size_t N, const size_t P, const size_t B, const double rtol, const double atol)
+{
+	memset(e,0,sizeof(oens_t));
+	e->N       = N;
+	e->P       = P;
+	e->B       = B;
+	e->rtol    = rtol;
+	e->atol    = atol;
+	e->h0      = 1e-3;
+	e->xmax    = 1e100;
+	e->maxstep = 10000000;
+	e->refill  = 1;
+	e->x   = malloc(((9*N+P+5)*B)*sizeof(double));
+	e->job = malloc(2*B*sizeof(size_t));
+	e->act = malloc(B*sizeof(int));
+	if (e->x == NULL || e->job == NULL || e->act == NULL) {
+		oens_free(e);
+		return -1;
+	}
+	e->xs   = e->x+N*B;
+	e->k    = e->xs+N*B;
+	e->p    = e->k+7*N*B;
+	e->t    = e->p+P*B;
+	e->h    = e->t+B;
+	e->tend = e->h+B;
+	e->err  = e->tend+B;
+	e->w    = e->err+B;
+	e->nst  = e->job+B;
+	return 0;
+}
+
+// Move lane a to lane b (all per-lane data, including the FSAL derivative)
+
+static inline void oens_move(oens_t* const e, const size_t a, const size_t b)
+{
+	const size_t N = e->N, B = e->B;
+	for (size_t i=0; i<N; ++i) {
+		e->x[B*i+b] = e->x[B*i+a];
+		e->k[B*i+b] = e->k[B*i+a];
+	}
+	for (size_t j=0; j<e->P; ++j) e->p[B*j+b] = e->p[B*j+a];
+	e->t[b]    = e->t[a];
+	e->h[b]    = e->h[a];
+	e->tend[b] = e->tend[a];
+	e->job[b]  = e->job[a];
+	e->nst[b]  = e->nst[a];
+	e->act[b]  = e->act[a];
+	e->act[a]  = 0;
+}
+
+// Integrate M trajectories: initial states X0 (M x N), parameters prm (M x P; may be NULL if P = 0), from
+// time 0 to tend[0 .. M-1]; final states into Y (M x N), and status into status[0 .. M-1] (may be NULL).
+// Returns the number of trajectories not completed (diverged, step limit or step size underflow). Steps
+// with a non-finite error estimate (e.g. overflow in a too-large step on a stiff trajectory) are rejected
+// and retried with a smaller step; only a state beyond xmax (or non-finite) is divergence.
+
+static inline size_t oens_run(oens_t* const e, const size_t M, const double* const X0, const double* const prm, const double* const tend, double* const Y, oens_status_t* const status, const oens_fun_t f, void* const arg)
+{
+	static const double a[7][6] = {
+		{0.0},
+		{1.0/5.0},
+		{3.0/40.0,9.0/40.0},
+		{44.0/45.0,-56.0/15.0,32.0/9.0},
+		{19372.0/6561.0,-25360.0/2187.0,64448.0/6561.0,-212.0/729.0},
+		{9017.0/3168.0,-355.0/33.0,46732.0/5247.0,49.0/176.0,-5103.0/18656.0},
+		{35.0/384.0,0.0,500.0/1113.0,125.0/192.0,-2187.0/6784.0,11.0/84.0} // = 5th-order weights
+	};
+	static const double ec[7] = {71.0/57600.0,0.0,-71.0/16695.0,71.0/1920.0,-17253.0/339200.0,22.0/525.0,-1.0/40.0}; // 5th - 4th order weights
+	const size_t N = e->N, P = e->P, B = e->B;
+	double* const x = e->x;
+	double* const xs = e->xs;
+	double* const k = e->k;
+	double* const h = e->h;
+	double* const err = e->err;
+	double* const w = e->w;
+	size_t next = 0, nact = 0, nfail = 0, nl = B;
+	int fresh = 1; // k[0] (FSAL) must be evaluated
+
+	for (size_t l=0; l<B; ++l) e->act[l] = 0;
+	for (;;) {
+
+		// Refill idle lanes from the queue (when at least B/4 are idle, or all), or compact
+
+		const size_t nidle = B-nact;
+		if (next < M && (nact == 0 || (e->refill && 4*nidle >= B))) {
+			for (size_t l=0; l<B && next<M; ++l) {
+				if (e->act[l]) continue;
+				for (size_t i=0; i<N; ++i) x[B*i+l] = X0[N*next+i];
+				for (size_t j=0; j<P; ++j) e->p[B*j+l] = prm[P*next+j];
+				e->t[l]    = 0.0;
+				h[l]       = fmin(e->h0,tend[next]);
+				e->tend[l] = tend[next];
+				e->job[l]  = next;
+				e->nst[l]  = 0;
+				e->act[l]  = 1;
+				++next;
+				++nact;
+			}
+			nl = B;
+			fresh = 1;
+		}
+		else if (next == M && e->refill && nact > 0) {
+			size_t b = 0;
+			for (size_t l=0; l<nl; ++l) {
+				if (!e->act[l]) continue;
+				if (l != b) oens_move(e,l,b);
+				++b;
+			}
+			const size_t nlv = (nact+OENS_VEC-1)/OENS_VEC*OENS_VEC;
+			nl = nlv < B ? nlv : B;
+		}
+		if (nact == 0) break;
+		for (size_t l=0; l<nl; ++l) { // idle lanes: harmless state
+			if (e->act[l]) continue;
+			h[l] = 0.0;
+			for (size_t i=0; i<N; ++i) x[B*i+l] = 0.0;
+		}
+		if (fresh) {
+			f(k,x,e->p,B,nl,arg);
+			fresh = 0;
+		}
+
+		// Dormand-Prince stages (lanes 0 .. nl-1); the last stage state is the 5th-order solution
+
+		for (size_t s=1; s<7; ++s) {
+			for (size_t i=0; i<N; ++i) {
+				double* const xsi = xs+B*i;
+				const double* const xi = x+B*i;
+				for (size_t l=0; l<nl; ++l) w[l] = a[s][0]*k[B*i+l];
+				for (size_t j=1; j<s; ++j) {
+					const double* const kj = k+N*B*j+B*i;
+					for (size_t l=0; l<nl; ++l) w[l] += a[s][j]*kj[l];
+				}
+				for (size_t l=0; l<nl; ++l) xsi[l] = xi[l]+h[l]*w[l];
+			}
+			f(k+N*B*s,xs,e->p,B,nl,arg);
+		}
+
+		// Error norms (RMS, mixed absolute/relative)
+
+		for (size_t l=0; l<nl; ++l) err[l] = 0.0;
+		for (size_t i=0; i<N; ++i) {
+			const double* const xi = x+B*i;
+			const double* const xsi = xs+B*i;
+			for (size_t l=0; l<nl; ++l) w[l] = ec[0]*k[B*i+l];
+			for (size_t j=2; j<7; ++j) { // ec[1] = 0
+				const double* const kj = k+N*B*j+B*i;
+				for (size_t l=0; l<nl; ++l) w[l] += ec[j]*kj[l];
+			}
+			for (size_t l=0; l<nl; ++l) {
+				const double r = h[l]*w[l]/(e->atol+e->rtol*fmax(fabs(xi[l]),fabs(xsi[l])));
+				err[l] += r*r;
+			}
+		}
+
+		// Accept or reject each lane (masked update), new step sizes
+
+		e->nbatch += 1;
+		e->nlane  += nl;
+		e->nact   += nact;
+		for (size_t l=0; l<nl; ++l) { // the accept decision, once per lane, for all updates below
+			err[l] = sqrt(err[l]/(double)N);
+			w[l]   = err[l] <= 1.0 ? 1.0 : 0.0;
+		}
+		for (size_t i=0; i<N; ++i) {
+			double* const xi = x+B*i;
+			double* const k0 = k+B*i;
+			const double* const xsi = xs+B*i;
+			const double* const k6 = k+6*N*B+B*i;
+			for (size_t l=0; l<nl; ++l) {
+				const int acc = w[l] != 0.0;
+				xi[l] = acc ? xsi[l] : xi[l];
+				k0[l] = acc ? k6[l] : k0[l];
+			}
+		}
+		for (size_t l=0; l<nl; ++l) {
+			if (!e->act[l]) continue;
+			const double en = err[l];
+			const int acc = w[l] != 0.0; // (a non-finite error norm rejects the step: x is unchanged)
+			int diverged = 0;
+			for (size_t i=0; i<N; ++i) diverged |= !(fabs(x[B*i+l]) <= e->xmax);
+			e->nacc += (size_t)acc;
+			e->nrej += (size_t)!acc;
+			if (acc) e->t[l] += h[l];
+			++e->nst[l];
+			const double rem = e->tend[l]-e->t[l];
+			const double fac = !isfinite(en) ? 0.2 : en > 0.0 ? fmin(5.0,fmax(0.2,0.9*pow(en,-0.2))) : 5.0;
+			h[l] = fmin(h[l]*fac,rem);
+			const int done = rem <= 1e-13*fmax(1.0,fabs(e->tend[l]));
+			const int hmin = !done && !(e->t[l]+h[l] != e->t[l]); // step no longer advances t
+			if (done || diverged || hmin || e->nst[l] >= e->maxstep) {
+				const size_t jb = e->job[l];
+				for (size_t i=0; i<N; ++i) Y[N*jb+i] = x[B*i+l];
+				if (status != NULL) status[jb] = done ? OENS_DONE : diverged ? OENS_DIVERGED : hmin ? OENS_HMIN : OENS_MAXSTEPS;
+				nfail += (size_t)!done;
+				e->act[l] = 0;
+				--nact;
+			}
+		}
+	}
+	return nfail;
+}
+
+#endif // ODEENS_H
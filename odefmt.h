@@ -0,0 +1,214 @@
+#ifndef ODEFMT_H
+#define ODEFMT_H
+
+// Fast fixed-precision double-to-text formatting, for ASCII trajectory output compatible with
+//
+//   	printf("%<width>.<prec>f",x)
+//
+// (byte-identical output, in the default round-to-nearest mode), without locale, varargs or format
+// parsing. The value is scaled exactly by 10^prec in 128-bit integer arithmetic and rounded half to
+// even on the exact binary value, as glibc does; values too large for the fast path (|x|*10^prec
+// >= 2^64), precisions above 17, infinities and NaNs fall back to snprintf.
+//
+// Whole blocks of rows are formatted into large buffers; ofmt_write_par formats contiguous chunks of
+// rows in parallel (POSIX threads), writing them out in order.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+// Maximum length of a formatted value (the largest double has 309 integer digits)
+
+#define OFMT_MAX(width,prec) ((size_t)(width)+(size_t)(prec)+312)
+
+__extension__ typedef unsigned __int128 ofmt_u128_t;
+
+static const char ofmt_digits2[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// Write the decimal digits of u right-aligned, ending at e (exclusive), with at least ndig digits
+// (zero-padded); returns pointer to first digit
+
+static inline char* ofmt_utoa(char* e, uint64_t u, size_t ndig)
+{
+	char* const e0 = e;
+	while (u >= 100) {
+		const size_t r = (size_t)(u%100)*2;
+		u /= 100;
+		*--e = ofmt_digits2[r+1];
+		*--e = ofmt_digits2[r];
+	}
+	if (u >= 10) {
+		*--e = ofmt_digits2[2*u+1];
+		*--e = ofmt_digits2[2*u];
+	}
+	else {
+		*--e = (char)('0'+u);
+	}
+	while ((size_t)(e0-e) < ndig) *--e = '0';
+	return e;
+}
+
+// Format x as printf("%*.*f",width,prec,x) into s (room for at least OFMT_MAX(width,prec) characters);
+// returns the number of characters written (no terminating NUL)
+
+static inline size_t ofmt_fixed(char* const s, const double x, const int width, const int prec)
+{
+	static const uint64_t pow10[18] = {
+		UINT64_C(1),UINT64_C(10),UINT64_C(100),UINT64_C(1000),UINT64_C(10000),UINT64_C(100000),UINT64_C(1000000),
+		UINT64_C(10000000),UINT64_C(100000000),UINT64_C(1000000000),UINT64_C(10000000000),UINT64_C(100000000000),
+		UINT64_C(1000000000000),UINT64_C(10000000000000),UINT64_C(100000000000000),UINT64_C(1000000000000000),
+		UINT64_C(10000000000000000),UINT64_C(100000000000000000)
+	};
+	uint64_t u;
+	memcpy(&u,&x,sizeof(u));
+	const int      neg = (int)(u>>63);
+	const unsigned E   = (unsigned)(u>>52)&0x7ff;
+	const uint64_t F   = u&((UINT64_C(1)<<52)-1);
+	uint64_t q = 0;
+	int fast = E != 0x7ff && prec >= 0 && prec <= 17;
+	if (fast) {
+		const uint64_t m = E == 0 ? F : F|(UINT64_C(1)<<52);
+		const int      e = E == 0 ? -1074 : (int)E-1075;
+		const ofmt_u128_t v = (ofmt_u128_t)m*pow10[prec]; // < 2^110
+		if (e >= 0) {
+			if (e >= 64 || (v>>(64-e)) != 0) fast = 0; // too large
+			else q = (uint64_t)(v<<e);
+		}
+		else if (-e < 128) {
+			const unsigned sh = (unsigned)-e;
+			const ofmt_u128_t qq = v>>sh;
+			if ((qq>>64) != 0) {
+				fast = 0; // too large
+			}
+			else {
+				const ofmt_u128_t one  = 1;
+				const ofmt_u128_t rem  = v&((one<<sh)-1);
+				const ofmt_u128_t half = one<<(sh-1);
+				q = (uint64_t)qq;
+				if (rem > half || (rem == half && (q&1))) ++q; // round half to even
+			}
+		} // else |x|*10^prec < 2^-18: rounds to zero
+	}
+	if (!fast) { // (the output is shorter than OFMT_MAX(width,prec), so the terminating NUL fits too)
+		const int len = snprintf(s,OFMT_MAX(width,prec),"%*.*f",width,prec,x);
+		return len > 0 ? (size_t)len : 0;
+	}
+	// digits: integer part, then fractional part
+	char tmp[48];
+	char* const e = tmp+sizeof(tmp);
+	char* b;
+	if (prec > 0) {
+		const uint64_t p10 = pow10[prec];
+		b = ofmt_utoa(e,q%p10,(size_t)prec);
+		*--b = '.';
+		b = ofmt_utoa(b,q/p10,1);
+	}
+	else {
+		b = ofmt_utoa(e,q,1);
+	}
+	if (neg) *--b = '-';
+	const size_t len = (size_t)(e-b);
+	const size_t pad = (size_t)width > len ? (size_t)width-len : 0;
+	memset(s,' ',pad);
+	memcpy(s+pad,b,len);
+	return pad+len;
+}
+
+// Format a row of N values into s (room for at least N*(1+OFMT_MAX(width,prec))+1 characters),
+// followed by a newline; if lead is non-zero each value is preceded by a space (" %w.pf" per value),
+// otherwise values are separated by a space ("%w.pf %w.pf ..."). Returns the number of characters.
+
+static inline size_t ofmt_row(char* const s, const double* const x, const size_t N, const int width, const int prec, const int lead)
+{
+	char* p = s;
+	for (size_t i=0; i<N; ++i) {
+		if (lead || i > 0) *p++ = ' ';
+		p += ofmt_fixed(p,x[i],width,prec);
+	}
+	*p++ = '\n';
+	return (size_t)(p-s);
+}
+
+// Format rows x N values (row-major) and write them to fs, through the buffer buf of size bsiz (at
+// least N*(1+OFMT_MAX(width,prec))+1); returns 0 on success, -1 on failure
+
+static inline int ofmt_write(FILE* const fs, const double* const blk, const size_t rows, const size_t N, const int width, const int prec, const int lead, char* const buf, const size_t bsiz)
+{
+	const size_t rmax = N*(1+OFMT_MAX(width,prec))+1;
+	size_t len = 0;
+	for (size_t k=0; k<rows; ++k) {
+		if (bsiz-len < rmax) {
+			if (fwrite(buf,1,len,fs) != len) return -1;
+			len = 0;
+		}
+		len += ofmt_row(buf+len,blk+N*k,N,width,prec,lead);
+	}
+	return fwrite(buf,1,len,fs) == len ? 0 : -1;
+}
+
+// Parallel formatting: each thread formats a contiguous chunk of rows into its own (growable) buffer
+
+typedef struct {
+	const double* blk;
+	size_t        rows;
+	size_t        N;
+	int           width;
+	int           prec;
+	int           lead;
+	char*         s;
+	size_t        len;
+	size_t        cap;
+} ofmt_chunk_t;
+
+static inline void* ofmt_chunk(void* const arg)
+{
+	ofmt_chunk_t* const c = arg;
+	const size_t rmax = c->N*(1+OFMT_MAX(c->width,c->prec))+1;
+	for (size_t k=0; k<c->rows; ++k) {
+		if (c->cap-c->len < rmax) {
+			const size_t cap = 2*c->cap+rmax;
+			char* const s = realloc(c->s,cap);
+			if (s == NULL) return arg; // failure
+			c->s   = s;
+			c->cap = cap;
+		}
+		c->len += ofmt_row(c->s+c->len,c->blk+c->N*k,c->N,c->width,c->prec,c->lead);
+	}
+	return NULL;
+}
+
+// As ofmt_write, but formatting in nthreads (at least 1) parallel chunks; returns 0 on success, -1 on
+// failure
+
+static inline int ofmt_write_par(FILE* const fs, const double* const blk, const size_t rows, const size_t N, const int width, const int prec, const int lead, const size_t nthreads)
+{
+	ofmt_chunk_t c[nthreads];
+	pthread_t    t[nthreads];
+	int          started[nthreads];
+	int          ret = 0;
+	for (size_t j=0; j<nthreads; ++j) {
+		const size_t k0 = (j*rows)/nthreads, k1 = ((j+1)*rows)/nthreads;
+		c[j] = (ofmt_chunk_t){blk+N*k0,k1-k0,N,width,prec,lead,NULL,0,0};
+		c[j].cap = (k1-k0)*(N*((size_t)width+1)+1)+N*(1+OFMT_MAX(width,prec))+1; // typical size; grown if necessary
+		c[j].s   = malloc(c[j].cap);
+		if (c[j].s == NULL) c[j].cap = 0;
+		started[j] = j > 0 && pthread_create(&t[j],NULL,ofmt_chunk,&c[j]) == 0;
+	}
+	if (ofmt_chunk(&c[0]) != NULL) ret = -1; // calling thread formats the first chunk
+	for (size_t j=1; j<nthreads; ++j) {
+		void* r = NULL;
+		if (started[j]) pthread_join(t[j],&r);
+		else            r = ofmt_chunk(&c[j]);
+		if (r != NULL) ret = -1;
+	}
+	for (size_t j=0; j<nthreads; ++j) {
+		if (ret == 0 && fwrite(c[j].s,1,c[j].len,fs) != c[j].len) ret = -1;
+		free(c[j].s);
+	}
+	return ret;
+}
+
+#endif // ODEFMT_H
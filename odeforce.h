@@ -0,0 +1,144 @@
+#ifndef ODEFORCE_H
+#define ODEFORCE_H
+
+// External forcing from recorded (memory-mapped) time series, for driven models
+//
+// The forcing input is a binary trajectory file of raw doubles (see odetrj.h): M channels sampled at
+// times t0+k*h, k = 0 .. n-1. The file is memory-mapped (see oderead.h), so it is never loaded as a
+// whole; as the integration advances, the pages ahead of the current sample are requested from the
+// kernel in windows of 'ahead' rows (madvise), so that page faults are overlapped with integration.
+//
+// oforce_eval interpolates all channels to an arbitrary time t, so that it may be called from a
+// non-autonomous ODE function (see ODET in ode.h) at the stage times:
+//
+//   	static inline void driven(double* const xdot, const double t, const double* const x, oforce_t* const F)
+//   	{
+//   		double u[F->M];
+//   		oforce_eval(F,t,u);
+//   		// ... xdot in terms of x and the forcing u
+//   	}
+//
+// Interpolation is sample-and-hold (OFORCE_HOLD), linear (OFORCE_LINEAR), or cubic (OFORCE_CUBIC: 4-point
+// Lagrange, exact for cubics, error O(h^4) for smooth inputs); times outside the recorded range are
+// clamped to its ends.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "oderead.h"
+
+typedef enum {OFORCE_HOLD = 0, OFORCE_LINEAR, OFORCE_CUBIC} oforce_interp_t;
+
+typedef struct {
+	otrj_map_t      m;      // mapped forcing file
+	const double*   u;      // samples (n x M)
+	size_t          M;      // number of channels
+	size_t          n;      // number of samples
+	double          t0;     // time of first sample
+	double          ih;     // inverse sample interval
+	oforce_interp_t interp; // interpolation method
+	size_t          ahead;  // prefetch window (rows)
+	size_t          pfnext; // row at which the next prefetch is issued
+	size_t          pgrows; // rows per page (at least 1)
+} oforce_t;
+
+// Map a forcing file, with prefetch window 'ahead' rows (0 for no prefetching)
+
+static inline int oforce_open(oforce_t* const f, const char* const path, const oforce_interp_t interp, const size_t ahead)
+{
+	memset(f,0,sizeof(oforce_t));
+	if (otrj_map(&f->m,path) != 0) return -1;
+	if (f->m.data == NULL || f->m.n == 0 || !(f->m.hdr.h > 0.0)) { // raw doubles only
+		otrj_unmap(&f->m);
+		errno = EINVAL;
+		return -1;
+	}
+	f->u      = f->m.data;
+	f->M      = f->m.N;
+	f->n      = f->m.n;
+	f->t0     = f->m.hdr.t0;
+	f->ih     = 1.0/f->m.hdr.h;
+	f->interp = interp;
+	f->ahead  = ahead;
+	f->pgrows = (size_t)sysconf(_SC_PAGESIZE)/(f->M*sizeof(double));
+	if (f->pgrows == 0) f->pgrows = 1;
+	madvise(f->m.map,f->m.maplen,MADV_SEQUENTIAL);
+	return 0;
+}
+
+static inline void oforce_close(oforce_t* const f)
+{
+	otrj_unmap(&f->m);
+	memset(f,0,sizeof(oforce_t));
+}
+
+// Request rows k .. k+ahead-1 from the kernel (called as the cursor passes half the previous window)
+
+static inline void oforce_prefetch(oforce_t* const f, const size_t k)
+{
+	if (f->ahead == 0 || k >= f->n) {
+		f->pfnext = SIZE_MAX;
+		return;
+	}
+	const size_t k1 = k+f->ahead < f->n ? k+f->ahead : f->n;
+	const long pg = sysconf(_SC_PAGESIZE);
+	const uintptr_t a = (uintptr_t)(f->u+f->M*k) & ~(uintptr_t)(pg-1);
+	const uintptr_t e = (uintptr_t)(f->u+f->M*k1);
+	madvise((void*)a,e-a,MADV_WILLNEED);
+	f->pfnext = k+(f->ahead/2 > f->pgrows ? f->ahead/2 : f->pgrows);
+}
+
+// Forcing (all channels) at time t, into u[0 .. M-1]
+
+static inline void oforce_eval(oforce_t* const f, const double t, double* const u)
+{
+	const size_t M = f->M, nl = f->n-1;
+	const double s = (t-f->t0)*f->ih;
+	size_t k;
+	double r;
+	if (!(s > 0.0)) { // before start (or NaN)
+		k = 0;
+		r = 0.0;
+	}
+	else if (s >= (double)nl) { // at or after end
+		k = nl;
+		r = 0.0;
+	}
+	else {
+		k = (size_t)s;
+		r = s-(double)k;
+	}
+	if (k >= f->pfnext) oforce_prefetch(f,k);
+	const double* const u1 = f->u+M*k;
+	if (f->interp == OFORCE_HOLD || r == 0.0) {
+		memcpy(u,u1,M*sizeof(double));
+		return;
+	}
+	const double* const u2 = u1+M;
+	if (f->interp == OFORCE_LINEAR || nl < 3) {
+		for (size_t i=0; i<M; ++i) u[i] = u1[i]+r*(u2[i]-u1[i]);
+		return;
+	}
+	const size_t j = k == 0 ? 0 : k+2 > nl ? nl-3 : k-1; // 4-point stencil j .. j+3 (one-sided at the ends)
+	const double* const v = f->u+M*j;
+	const double q = s-(double)j-1.0, qp = q+1.0, qm = q-1.0, qmm = q-2.0;
+	const double w0 = -q*qm*qmm/6.0;
+	const double w1 = 0.5*qp*qm*qmm;
+	const double w2 = -0.5*qp*q*qmm;
+	const double w3 = qp*q*qm/6.0;
+	for (size_t i=0; i<M; ++i) u[i] = w0*v[i]+w1*v[M+i]+w2*v[2*M+i]+w3*v[3*M+i];
+}
+
+// Single channel c at time t (e.g. for ODE1T)
+
+static inline double oforce_chan(oforce_t* const f, const double t, const size_t c)
+{
+	double u[f->M];
+	oforce_eval(f,t,u);
+	return u[c];
+}
+
+#endif // ODEFORCE_H
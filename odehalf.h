@@ -0,0 +1,154 @@
+#ifndef ODEHALF_H
+#define ODEHALF_H
+
+// Half-precision (IEEE binary16) and bfloat16 storage of trajectories
+//
+// The integration is carried out in double precision; states are converted to 16-bit values only for
+// storage, cutting the memory (or file size) for an N x n trajectory by 4x compared to double. This is
+// intended for visualisation datasets: float16 has ~3 significant decimal digits and a range of
+// +/-65504 (larger values become infinite), while bfloat16 has ~2 digits but the full float range.
+//
+// Conversions round to nearest even (via float; ties at the float rounding of a double may round
+// differently from a single direct rounding, which is immaterial at 16-bit precision). They are
+// branch-free bit manipulations, so that the block conversion loops ohalf_pack/ohalf_unpack vectorise;
+// if compiled with F16C support (e.g. -mf16c or -march=native on x86), the hardware conversion
+// instructions are used for float16.
+//
+// For a stored trajectory, with double-precision integration state x:
+//
+//   	uint16_t* const y = malloc(N*n*sizeof(uint16_t));
+//   	for (size_t k=0; k<n; ++k) {
+//   		if (k > 0) ODESTEP(solver,odefun,x,N,h,...);
+//   		ohalf_pack(y+N*k,x,N,OTRJ_FLOAT16);
+//   	}
+//
+// Trajectory files of value type OTRJ_FLOAT16/OTRJ_BFLOAT16 (see odetrj.h) may be written with the
+// asynchronous writer block function ow_half, and are read (converted back to double) by oderead.h.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#include "odetrj.h"
+
+static inline uint32_t ohalf_fbits(const float f)
+{
+	uint32_t u;
+	memcpy(&u,&f,sizeof(u));
+	return u;
+}
+
+static inline float ohalf_bitsf(const uint32_t u)
+{
+	float f;
+	memcpy(&f,&u,sizeof(f));
+	return f;
+}
+
+// float -> float16 (round to nearest even; overflow to infinity; NaNs stay (quiet) NaNs). Selections
+// are by bit masks rather than conditionals, so that conversion loops vectorise.
+
+static inline uint16_t ohalf_from_float(const float x)
+{
+	const uint32_t u    = ohalf_fbits(x);
+	const uint32_t sign = (u>>16)&0x8000;
+	const uint32_t a    = u&0x7fffffff;
+	const uint32_t mnan = -(uint32_t)(a > 0x7f800000);
+	const uint32_t mbig = -(uint32_t)(a >= 0x47800000);
+	const uint32_t msub = -(uint32_t)(a < 0x38800000);
+	const uint32_t big  = 0x7c00|(mnan&0x0200); // infinity (overflow), or quiet NaN
+	const uint32_t sub  = ohalf_fbits(ohalf_bitsf(a)+0.5f)-0x3f000000; // subnormal or zero: rounding by addition
+	const uint32_t nrm  = (a+0xc8000fff+((a>>13)&1))>>13; // normal: rebias exponent, round mantissa
+	return (uint16_t)(sign|(mbig&big)|(msub&sub)|(~(mbig|msub)&nrm));
+}
+
+// float16 -> float (exact)
+
+static inline float ohalf_to_float(const uint16_t h)
+{
+	const uint32_t sign = (uint32_t)(h&0x8000)<<16;
+	const uint32_t e    = (uint32_t)(h&0x7c00);
+	const uint32_t m    = (uint32_t)(h&0x7fff)<<13;
+	const uint32_t minf = -(uint32_t)(e == 0x7c00);
+	const uint32_t msub = -(uint32_t)(e == 0);
+	const uint32_t sub  = ohalf_fbits(ohalf_bitsf(m+0x38800000)-ohalf_bitsf(0x38800000)); // subnormal or zero: exact by subtraction
+	const uint32_t nrm  = m+0x38000000+(minf&0x38000000); // exponent 31: infinity/NaN
+	return ohalf_bitsf(sign|(msub&sub)|(~msub&nrm));
+}
+
+// float -> bfloat16 (round to nearest even; NaNs stay (quiet) NaNs)
+
+static inline uint16_t obf16_from_float(const float x)
+{
+	const uint32_t u = ohalf_fbits(x);
+	const uint32_t r = (u+0x7fff+((u>>16)&1))>>16;
+	const uint32_t mnan = -(uint32_t)((u&0x7fffffff) > 0x7f800000);
+	return (uint16_t)((mnan&((u>>16)|0x40))|(~mnan&r));
+}
+
+// bfloat16 -> float (exact)
+
+static inline float obf16_to_float(const uint16_t b)
+{
+	return ohalf_bitsf((uint32_t)b<<16);
+}
+
+// Convert n doubles to 16-bit values of the given type (OTRJ_FLOAT16 or OTRJ_BFLOAT16)
+
+static inline void ohalf_pack(uint16_t* const y, const double* const x, const size_t n, const otrj_type_t type)
+{
+	if (type == OTRJ_BFLOAT16) {
+		for (size_t i=0; i<n; ++i) y[i] = obf16_from_float((float)x[i]);
+		return;
+	}
+	size_t i = 0;
+#ifdef __F16C__
+	for (; i+8 <= n; i += 8) {
+		const __m256 f = _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(x+i+4)),_mm256_cvtpd_ps(_mm256_loadu_pd(x+i)));
+		_mm_storeu_si128((__m128i*)(y+i),_mm256_cvtps_ph(f,_MM_FROUND_TO_NEAREST_INT));
+	}
+#endif
+	for (; i<n; ++i) y[i] = ohalf_from_float((float)x[i]);
+}
+
+// Convert n 16-bit values of the given type back to double (exact)
+
+static inline void ohalf_unpack(double* const x, const uint16_t* const y, const size_t n, const otrj_type_t type)
+{
+	if (type == OTRJ_BFLOAT16) {
+		for (size_t i=0; i<n; ++i) x[i] = (double)obf16_to_float(y[i]);
+		return;
+	}
+	size_t i = 0;
+#ifdef __F16C__
+	for (; i+8 <= n; i += 8) {
+		const __m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(y+i)));
+		_mm256_storeu_pd(x+i,  _mm256_cvtps_pd(_mm256_castps256_ps128(f)));
+		_mm256_storeu_pd(x+i+4,_mm256_cvtps_pd(_mm256_extractf128_ps(f,1)));
+	}
+#endif
+	for (; i<n; ++i) x[i] = (double)ohalf_to_float(y[i]);
+}
+
+// Asynchronous writer block function (see odewrite.h) for trajectory files of value type OTRJ_FLOAT16
+// or OTRJ_BFLOAT16 (arg points to the otrj_type_t)
+
+#define OHALF_CHUNK 4096
+
+static inline int ow_half(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+{
+	const otrj_type_t type = *(const otrj_type_t*)arg;
+	uint16_t y[OHALF_CHUNK];
+	for (size_t i=0, n=rows*N; i<n; i += OHALF_CHUNK) {
+		const size_t m = n-i < OHALF_CHUNK ? n-i : OHALF_CHUNK;
+		ohalf_pack(y,blk+i,m,type);
+		if (fwrite(y,sizeof(uint16_t),m,fs) != m) return -1;
+	}
+	return 0;
+}
+
+#endif // ODEHALF_H
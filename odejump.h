@@ -0,0 +1,108 @@
+#ifndef ODEJUMP_H
+#define ODEJUMP_H
+
+// Jump-diffusion SDEs: Poisson (shot-noise) jumps on top of drift and Wiener noise
+//
+//   	dx = f(x) dt + dW + dJ
+//
+// where J is a compound Poisson process of rate lam, with jumps applied by a user function (which draws
+// the amplitude from any distribution, and may choose which variables jump). Rather than testing for a
+// jump at every step (a Bernoulli trial per step, with jumps quantised to the step grid), the time of
+// the next jump is drawn from the exponential waiting time distribution, so that the cost is one
+// comparison per step plus O(1) per jump. Steps containing jump times are split at those times: the
+// drift is integrated up to the jump, the jump applied, and integration continued, so that jumps occur
+// at their exact times.
+//
+// JDSTEP/JDSTEP1 are as ODESTEP/ODESTEP1 (see ode.h), with the jump process j (ojump_t*), and the jump
+// function jumpfun(x,t,jarg) (x is double*, also for JDSTEP1). As for ODESTEP, Wiener increments are
+// added to x after each step. The time after k steps is computed as t0+k*h (no accumulated rounding, as
+// for ODET), so h must be the same for all steps on a given j. E.g., shot noise with exponential
+// amplitudes of mean A:
+//
+//   	static double unif(void* const rng) { return mt_rand(rng); }
+//   	static void shot(double* const x, const double t, void* const rng) { x[0] += -A*log(1.0-mt_rand(rng)); }
+//
+//   	ojump_t j;
+//   	ojump_init(&j,lam,0.0,unif,&rng);
+//   	for (size_t k=1; k<n; ++k) {
+//   		JDSTEP1(solver,odefun,x,h,&j,shot,&rng,...);
+//   		x += sig*sqrt(h)*mt_randn(&rng);
+//   	}
+
+#include <stddef.h>
+#include <math.h>
+
+typedef double (*ojump_unif_t)(void* const arg); // uniform variates on [0,1)
+
+typedef struct {
+	double       lam;   // jump rate
+	double       t0;    // initial time
+	double       t;     // current time
+	size_t       nstep; // number of steps so far
+	double       T;     // time of the next jump
+	ojump_unif_t unif;  // uniform generator
+	void*        uarg;  // uniform generator argument
+	size_t       njump; // number of jumps so far
+} ojump_t;
+
+// Draw the next jump time (exponential waiting time)
+
+static inline void ojump_next(ojump_t* const j)
+{
+	j->T += j->lam > 0.0 ? -log(1.0-j->unif(j->uarg))/j->lam : INFINITY;
+}
+
+// Jump process of rate lam (lam = 0 for none) from time t0
+
+static inline void ojump_init(ojump_t* const j, const double lam, const double t0, const ojump_unif_t unif, void* const uarg)
+{
+	j->lam   = lam;
+	j->t0    = t0;
+	j->t     = t0;
+	j->nstep = 0;
+	j->T     = t0;
+	j->unif  = unif;
+	j->uarg  = uarg;
+	j->njump = 0;
+	ojump_next(j);
+}
+
+// Jump-diffusion step (drift and jumps; add Wiener increments after the step)
+
+#define JDSTEP(ode,odefun,x,N,h,j,jumpfun,jarg,...) \
+{ \
+	double tj_ = (j)->t; \
+	++(j)->nstep; \
+	const double t1_ = (j)->t0+(double)(j)->nstep*(h); \
+	while ((j)->T <= t1_) { \
+		const double hj_ = (j)->T-tj_; \
+		if (hj_ > 0.0) ODESTEP(ode,odefun,x,N,hj_,__VA_ARGS__); \
+		jumpfun(x,(j)->T,jarg); \
+		++(j)->njump; \
+		tj_ = (j)->T; \
+		ojump_next(j); \
+	} \
+	const double hr_ = t1_-tj_; \
+	if (hr_ > 0.0) ODESTEP(ode,odefun,x,N,hr_,__VA_ARGS__); \
+	(j)->t = t1_; \
+}
+
+#define JDSTEP1(ode,odefun,x,h,j,jumpfun,jarg,...) \
+{ \
+	double tj_ = (j)->t; \
+	++(j)->nstep; \
+	const double t1_ = (j)->t0+(double)(j)->nstep*(h); \
+	while ((j)->T <= t1_) { \
+		const double hj_ = (j)->T-tj_; \
+		if (hj_ > 0.0) ODESTEP1(ode,odefun,x,hj_,__VA_ARGS__); \
+		jumpfun(&(x),(j)->T,jarg); \
+		++(j)->njump; \
+		tj_ = (j)->T; \
+		ojump_next(j); \
+	} \
+	const double hr_ = t1_-tj_; \
+	if (hr_ > 0.0) ODESTEP1(ode,odefun,x,hr_,__VA_ARGS__); \
+	(j)->t = t1_; \
+}
+
+#endif // ODEJUMP_H
@@ -0,0 +1,119 @@
+#ifndef ODEKUR_H
+#define ODEKUR_H
+
+// All-to-all (mean-field) coupled phase oscillators: Kuramoto(-Sakaguchi) model in O(N) per RHS evaluation
+//
+//   	theta_i' = omega_i + (K/N) sum_j sin(theta_j-theta_i-alpha)
+//
+// Written directly, the coupling sum costs O(N^2) per evaluation (N^2 sines). Since the coupling is
+// through the complex order parameter Z = R exp(i Psi) = (1/N) sum_j exp(i theta_j) only,
+//
+//   	theta_i' = omega_i + K Im(Z exp(-i(theta_i+alpha))) = omega_i + K (S' cos theta_i - C' sin theta_i)
+//
+// with C'+iS' = Z exp(-i alpha); okur_rhs computes Z once per evaluation (i.e. once per stage of a
+// Runge-Kutta step) from cos/sin of all phases, keeps the cos/sin values for the coupling term, and so
+// is O(N), with two vectorisable passes. It is an ODE function for ODE/ODESTEP (see ode.h):
+//
+//   	okur_t k;
+//   	okur_init(&k,N,omega,K,alpha);
+//   	ODE(solver,okur_rhs,x,N,n,h,&k);     // or ODESTEP(solver,okur_rhs,x,N,h,&k)
+//   	// ... order parameter at the last evaluation in k.R, k.Psi
+//   	okur_free(&k);
+//
+// For ensembles of independent networks, each member needs its own okur_t (scratch space). The cos/sin
+// evaluation okur_sincos is branch-free (reduction modulo 2 pi, polynomial on the half angle and angle
+// doubling), so that it vectorises, unlike calls to the libm functions. The reduction is Cody-Waite with
+// 2 pi split into four parts, the first three of 18 bits, so that their products with the multiple of
+// 2 pi are exact for |x| < 2e11, where the absolute error is ~1e-15; beyond, it is of the order of the
+// spacing of doubles at x (the resolution of the phase itself, ~3e-5 at 2e11). Phases grow without
+// bound in long runs, so reduce them (modulo 2 pi) occasionally if they may approach that range.
+
+#include <stdlib.h>
+#include <math.h>
+
+typedef struct {
+	size_t        N;     // number of oscillators
+	const double* omega; // natural frequencies
+	double        K;     // coupling strength
+	double        ca;    // cos(alpha) (phase lag)
+	double        sa;    // sin(alpha)
+	double*       c;     // cos(theta) (scratch)
+	double*       s;     // sin(theta) (scratch)
+	double        R;     // order parameter modulus (last evaluation)
+	double        Psi;   // order parameter phase (last evaluation)
+} okur_t;
+
+// Set up for N oscillators with natural frequencies omega (not copied), coupling strength K and phase
+// lag alpha; returns 0 on success, -1 on failure
+
+static inline int okur_init(okur_t* const k, const size_t N, const double* const omega, const double K, const double alpha)
+{
+	k->N     = N;
+	k->omega = omega;
+	k->K     = K;
+	k->ca    = cos(alpha);
+	k->sa    = sin(alpha);
+	k->R     = 0.0;
+	k->Psi   = 0.0;
+	k->c     = malloc(2*(N > 0 ? N : 1)*sizeof(double));
+	if (k->c == NULL) return -1;
+	k->s     = k->c+N;
+	return 0;
+}
+
+static inline void okur_free(okur_t* const k)
+{
+	free(k->c);
+	k->c = k->s = NULL;
+}
+
+// Branch-free cos/sin of x (accurate for |x| < 2e11): x is reduced to r in [-pi,pi] (round to nearest
+// by the 1.5*2^52 addition, 2 pi in four parts), cos/sin of r/2 by Taylor polynomials on [-pi/2,pi/2],
+// then doubled.
+
+static inline void okur_sincos(const double x, double* const c, double* const s)
+{
+	const double rnd = 6755399441055744.0;                  // 1.5*2^52
+	const double p1 = 6.283172607421875, p2 = 1.2699747458100319e-5, p3 = 1.025335372162317e-11, p4 = 2.2884754904439327e-17; // 2 pi = p1+p2+p3+p4
+	const double m = (x*0.15915494309189533577+rnd)-rnd;   // nearest integer to x/(2 pi)
+	const double r = 0.5*((((x-m*p1)-m*p2)-m*p3)-m*p4);    // half angle, in [-pi/2,pi/2]
+	const double r2 = r*r;
+	const double sh = r*(1.0+r2*(-1.0/6.0+r2*(1.0/120.0+r2*(-1.0/5040.0+r2*(1.0/362880.0+r2*(-1.0/39916800.0
+		+r2*(1.0/6227020800.0+r2*(-1.0/1307674368000.0+r2*(1.0/355687428096000.0+r2*(-1.0/121645100408832000.0))))))))));
+	const double ch = 1.0+r2*(-0.5+r2*(1.0/24.0+r2*(-1.0/720.0+r2*(1.0/40320.0+r2*(-1.0/3628800.0+r2*(1.0/479001600.0
+		+r2*(-1.0/87178291200.0+r2*(1.0/20922789888000.0+r2*(-1.0/6402373705728000.0+r2*(1.0/2432902008176640000.0))))))))));
+	*c = (ch-sh)*(ch+sh);
+	*s = 2.0*sh*ch;
+}
+
+// Order parameter Z = C+iS of the phases x, with cos/sin of the phases into c, s
+
+static inline void okur_order(const size_t N, const double* const restrict x, double* const restrict c, double* const restrict s, double* const C, double* const S)
+{
+	for (size_t i=0; i<N; ++i) okur_sincos(x[i],c+i,s+i); // vectorised
+	double sc = 0.0, ss = 0.0;
+	for (size_t i=0; i<N; ++i) {
+		sc += c[i];
+		ss += s[i];
+	}
+	*C = sc/(double)N;
+	*S = ss/(double)N;
+}
+
+// Kuramoto(-Sakaguchi) RHS (ODE function), O(N)
+
+static inline void okur_rhs(double* const xdot, const double* const x, okur_t* const k)
+{
+	const size_t N = k->N;
+	double C, S;
+	okur_order(N,x,k->c,k->s,&C,&S);
+	k->R   = sqrt(C*C+S*S);
+	k->Psi = atan2(S,C);
+	const double Ka = k->K*(C*k->ca+S*k->sa), Kb = k->K*(S*k->ca-C*k->sa); // K Z exp(-i alpha)
+	const double* const restrict c = k->c;
+	const double* const restrict s = k->s;
+	const double* const restrict omega = k->omega;
+	for (size_t i=0; i<N; ++i) xdot[i] = omega[i]+Kb*c[i]-Ka*s[i];
+}
+
+#endif // ODEKUR_H
@@ -0,0 +1,160 @@
+#ifndef ODELIF_H
+#define ODELIF_H
+
+// Hybrid (integrate-and-fire) ensembles: leaky integrate-and-fire neurons with Ornstein-Uhlenbeck input,
+// threshold detection within the step, spike-time interpolation, reset map and refractory period
+//
+// Each of the M neurons has membrane potential v and input current u (in voltage units):
+//
+//   	tau  dv = (EL-v+u) dt                                   (below threshold, not refractory)
+//   	tauI du = (mu-u) dt + sig*sqrt(2*tauI) dW               (stationary standard deviation sig)
+//
+// When v reaches vth, a spike is emitted, v is reset to vreset and held there for the refractory
+// period tref. The input is updated exactly (OU recursion, with caller-supplied standard normal
+// variates), and v by Heun's method. Spike times are located within the step by a Newton step on
+// the cubic Hermite interpolant of v (end-point values and derivatives), and the refractory period
+// runs from the interpolated spike time, so that spike timing is not quantised to the step grid.
+//
+// The state is held as separate arrays (structure of arrays), and the update of all neurons is a
+// single loop without branches (threshold, reset and refractoriness are selections), so that it
+// vectorises; spikes are then gathered into an event list (neuron index, time) in a second pass.
+
+#include <stdlib.h>
+#include <math.h>
+
+// The update loop vectorises only if the compiler may if-convert the selects, which gcc does only when
+// FP exceptions are assumed not to trap; rather than requiring -fno-trapping-math for the whole build,
+// it is set for the update functions only (gcc). Other compilers (or gcc without optimisation of these
+// functions) give the same results, with a scalar loop; callers may also build with -fno-trapping-math.
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define OLIF_NOTRAP __attribute__((optimize("no-trapping-math")))
+#else
+#define OLIF_NOTRAP
+#endif
+
+typedef struct {
+	double tau;    // membrane time constant
+	double EL;     // resting potential
+	double vth;    // threshold
+	double vreset; // reset potential
+	double tref;   // refractory period
+	double mu;     // input mean
+	double tauI;   // input time constant
+	double sig;    // input standard deviation
+} olif_par_t;
+
+typedef struct {
+	size_t     M;    // number of neurons
+	olif_par_t p;    // parameters
+	double*    v;    // membrane potentials
+	double*    u;    // input currents
+	double*    r;    // refractory time remaining
+	double*    ts;   // spike time within the current step (or -INFINITY)
+	size_t     nspk; // spikes in the last step
+	size_t*    spi;  // spiking neurons in the last step
+	double*    spt;  // spike times in the last step
+	size_t     ntot; // total spikes
+} olif_t;
+
+// Set up M neurons, with potentials uniform on [vreset,vth), inputs at mu; returns 0 on success, -1
+// on failure
+
+static inline int olif_init(olif_t* const e, const size_t M, const olif_par_t* const p)
+{
+	e->M    = M;
+	e->p    = *p;
+	e->nspk = 0;
+	e->ntot = 0;
+	e->v    = malloc(4*M*sizeof(double));
+	e->spi  = malloc(M*sizeof(size_t));
+	e->spt  = malloc(M*sizeof(double));
+	if (e->v == NULL || e->spi == NULL || e->spt == NULL) {
+		free(e->v);
+		free(e->spi);
+		free(e->spt);
+		return -1;
+	}
+	e->u  = e->v+M;
+	e->r  = e->u+M;
+	e->ts = e->r+M;
+	for (size_t i=0; i<M; ++i) {
+		e->v[i] = p->vreset+(p->vth-p->vreset)*((double)i+0.5)/(double)M;
+		e->u[i] = p->mu;
+		e->r[i] = 0.0;
+		e->ts[i] = -INFINITY;
+	}
+	return 0;
+}
+
+static inline void olif_free(olif_t* const e)
+{
+	free(e->v);
+	free(e->spi);
+	free(e->spt);
+	e->v = e->u = e->r = e->ts = e->spt = NULL;
+	e->spi = NULL;
+}
+
+// Update of neuron i (zi standard normal variate). Written without branches (all quantities are
+// computed, then selected), so that the loop over neurons vectorises (see OLIF_NOTRAP).
+
+OLIF_NOTRAP static inline void olif_neuron(const olif_par_t* const p, double* const restrict v, double* const restrict u, double* const restrict r, double* const restrict ts, const size_t i, const double t, const double h, const double itau, const double a, const double b, const double zi)
+{
+	const double I0 = u[i];
+	const double I1 = p->mu+a*(I0-p->mu)+b*zi;                // exact OU update
+	const double v0 = v[i];
+	const double k1 = (p->EL-v0+I0)*itau;                       // Heun step
+	const double k2 = (p->EL-(v0+h*k1)+I1)*itau;
+	const double v1 = v0+0.5*h*(k1+k2);
+	const double r0 = r[i];                                  // refractory: held at reset, then
+	const double rr = r0 < h ? r0 : h;                          // integrated over the rest of the step
+	const double vr = p->vreset+(h-rr)*(p->EL-p->vreset+I1)*itau;
+	const int    refr = r0 > 0.0;
+	const int    spk = (r0 <= 0.0) & (v1 >= p->vth);
+	const double d0 = h*k1, d1 = h*(p->EL-v1+I1)*itau;         // Hermite interpolant derivatives (per step)
+	const double tl = (p->vth-v0)/(v1-v0);                      // spike time: linear guess, then a Newton step
+	const double tl2 = tl*tl, tl3 = tl2*tl;
+	const double H  = (2.0*tl3-3.0*tl2+1.0)*v0+(tl3-2.0*tl2+tl)*d0+(3.0*tl2-2.0*tl3)*v1+(tl3-tl2)*d1;
+	const double dH = (6.0*tl2-6.0*tl)*(v0-v1)+(3.0*tl2-4.0*tl+1.0)*d0+(3.0*tl2-2.0*tl)*d1;
+	double th = tl-(H-p->vth)/dH;
+	th = th > 0.0 ? (th < 1.0 ? th : 1.0) : 0.0;
+	const double rs = p->tref-(1.0-th)*h;                       // refractory time remaining after spike
+	const double rp = rs > 0.0 ? rs : 0.0;
+	const double vs = p->vreset+(rp-rs)*(p->EL-p->vreset+I1)*itau; // integrated after short refractory period
+	const double vn = refr ? vr : v1;
+	v[i]  = spk ? vs : vn;
+	r[i]  = spk ? rp : r0-rr;
+	u[i]  = I1;
+	ts[i] = spk ? t+th*h : -INFINITY;
+}
+
+// Advance all neurons from time t to t+h, with z[0 .. M-1] standard normal variates for the input
+// noise (may be NULL if sig = 0); returns the number of spikes, listed in spi/spt
+
+OLIF_NOTRAP static inline size_t olif_step(olif_t* const e, const double t, const double h, const double* const z)
+{
+	const size_t M = e->M;
+	const olif_par_t p = e->p;
+	const double itau = 1.0/p.tau;
+	const double a = exp(-h/e->p.tauI), b = e->p.sig*sqrt(1.0-a*a);
+	if (z != NULL) {
+		for (size_t i=0; i<M; ++i) olif_neuron(&p,e->v,e->u,e->r,e->ts,i,t,h,itau,a,b,z[i]);
+	}
+	else {
+		for (size_t i=0; i<M; ++i) olif_neuron(&p,e->v,e->u,e->r,e->ts,i,t,h,itau,a,0.0,0.0);
+	}
+	size_t nspk = 0; // gather spike events (spikes are rare, so the branch is well predicted)
+	for (size_t i=0; i<M; ++i) {
+		if (e->ts[i] >= t) {
+			e->spi[nspk] = i;
+			e->spt[nspk] = e->ts[i];
+			++nspk;
+		}
+	}
+	e->nspk = nspk;
+	e->ntot += nspk;
+	return nspk;
+}
+
+#endif // ODELIF_H
@@ -0,0 +1,214 @@
+#ifndef ODEMC_H
+#define ODEMC_H
+
+// Monte Carlo ensembles of SDEs with variance reduction: antithetic noise pairs and control variates
+//
+// OMCSDE integrates an ensemble of paths of an SDE with additive (diagonal) noise,
+//
+//   	dx_i = f_i(x) dt + sig_i dW_i
+//
+// from a common initial state, and estimates the expectation of a quantity of interest Y = q(x(T)) of the
+// final state. Two variance reduction techniques are supported:
+//
+// - Antithetic pairs: each path is integrated alongside its mirror, driven by the same standard normal
+//   variates negated. The pair average is the sample, so each variate drives two paths (halving the
+//   random number cost per path), and for Y monotone in the noise the pair members are negatively
+//   correlated, which reduces the variance.
+//
+// - Control variates: q also returns P controls C_1 .. C_P with known means mu (e.g. moments of a
+//   linear approximation, or of the discretised process itself). The estimate is Ybar - beta.(Cbar-mu),
+//   with the variance-minimising beta = Cov(C)^-1 Cov(C,Y) estimated from the samples; the variance is
+//   reduced by the factor 1-R^2 (R^2 the squared multiple correlation of Y with the controls).
+//
+// Samples are accumulated online (means and co-moments, Welford), so paths are never stored; the
+// wall-clock time and the number of variates drawn are recorded, so that estimators may be compared by
+// variance x cost (omc_result). Accumulators for separate chunks of the ensemble (e.g. on separate
+// threads, each with its own generator) may be merged with omc_merge.
+//
+//   	static void qfun(double* const q, const double* const x, void* const arg) // q[0] = Y, q[1..P] = controls
+//   	static double randn(void* const rng) { return mt_randn(rng); }
+//
+//   	omc_t mc;
+//   	omc_init(&mc,P,mu,anti,randn,&rng);
+//   	OMCSDE(solver,odefun,N,h,n,x0,sig,m,&mc,qfun,qarg,...); // m samples (pairs, if antithetic)
+//   	double est, se;
+//   	omc_result(&mc,&est,&se,NULL);
+//   	omc_free(&mc);
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+typedef double (*omc_randn_t)(void* const arg); // standard normal variates
+typedef void   (*omc_q_t)(double* const q, const double* const x, void* const arg);
+
+typedef struct {
+	size_t      P;     // number of control variates
+	int         anti;  // antithetic pairs?
+	double*     mu;    // control means (P)
+	size_t      m;     // number of samples (pairs, if antithetic)
+	double*     mean;  // sample means of (Y,C) (P+1)
+	double*     M2;    // co-moments of (Y,C) ((P+1) x (P+1))
+	omc_randn_t randn; // normal generator
+	void*       rarg;  // normal generator argument
+	size_t      nrand; // variates drawn
+	size_t      npath; // paths integrated
+	double      time;  // wall-clock time (seconds)
+} omc_t;
+
+static inline double omc_wtime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec+1e-9*(double)ts.tv_nsec;
+}
+
+// P controls with known means mu (copied; may be NULL if P = 0), antithetic pairs if anti != 0
+
+static inline int omc_init(omc_t* const mc, const size_t P, const double* const mu, const int anti, const omc_randn_t randn, void* const rarg)
+{
+	memset(mc,0,sizeof(omc_t));
+	mc->P     = P;
+	mc->anti  = anti;
+	mc->randn = randn;
+	mc->rarg  = rarg;
+	mc->mu    = calloc(P+(P+1)+(P+1)*(P+1),sizeof(double));
+	if (mc->mu == NULL) return -1;
+	mc->mean  = mc->mu+P;
+	mc->M2    = mc->mean+(P+1);
+	if (P > 0) memcpy(mc->mu,mu,P*sizeof(double));
+	return 0;
+}
+
+static inline void omc_free(omc_t* const mc)
+{
+	free(mc->mu);
+	mc->mu = mc->mean = mc->M2 = NULL;
+}
+
+// Add a sample q = (Y,C_1 .. C_P)
+
+static inline void omc_add(omc_t* const mc, const double* const q)
+{
+	const size_t Q = mc->P+1;
+	double d[Q];
+	++mc->m;
+	for (size_t i=0; i<Q; ++i) {
+		d[i] = q[i]-mc->mean[i];
+		mc->mean[i] += d[i]/(double)mc->m;
+	}
+	for (size_t i=0; i<Q; ++i) {
+		for (size_t k=0; k<Q; ++k) mc->M2[Q*i+k] += d[i]*(q[k]-mc->mean[k]);
+	}
+}
+
+// Merge accumulator b into a (Chan et al. parallel update; same controls)
+
+static inline void omc_merge(omc_t* const a, const omc_t* const b)
+{
+	const size_t Q = a->P+1;
+	if (b->m == 0) return;
+	const double na = (double)a->m, nb = (double)b->m, n = na+nb;
+	for (size_t i=0; i<Q; ++i) {
+		for (size_t k=0; k<Q; ++k) a->M2[Q*i+k] += b->M2[Q*i+k]+(b->mean[i]-a->mean[i])*(b->mean[k]-a->mean[k])*na*nb/n;
+	}
+	for (size_t i=0; i<Q; ++i) a->mean[i] += (b->mean[i]-a->mean[i])*nb/n;
+	a->m     += b->m;
+	a->nrand += b->nrand;
+	a->npath += b->npath;
+	a->time  += b->time;
+}
+
+// Estimate of E[Y] and its standard error; if vc is not NULL, *vc = variance x cost (estimator variance
+// times wall-clock time: smaller is better, and independent of ensemble size). Control variate
+// coefficients are obtained by Gaussian elimination with partial pivoting; requires m > P+1.
+
+static inline void omc_result(const omc_t* const mc, double* const est, double* const se, double* const vc)
+{
+	const size_t P = mc->P, Q = P+1;
+	double A[P > 0 ? P*P : 1], beta[P > 0 ? P : 1];
+	for (size_t i=0; i<P; ++i) { // Cov(C) beta = Cov(C,Y)
+		for (size_t k=0; k<P; ++k) A[P*i+k] = mc->M2[Q*(i+1)+(k+1)];
+		beta[i] = mc->M2[Q*(i+1)];
+	}
+	for (size_t c=0; c<P; ++c) {
+		size_t p = c;
+		for (size_t i=c+1; i<P; ++i) if (fabs(A[P*i+c]) > fabs(A[P*p+c])) p = i;
+		if (p != c) {
+			for (size_t k=0; k<P; ++k) {
+				const double t = A[P*c+k];
+				A[P*c+k] = A[P*p+k];
+				A[P*p+k] = t;
+			}
+			const double t = beta[c];
+			beta[c] = beta[p];
+			beta[p] = t;
+		}
+		for (size_t i=c+1; i<P; ++i) {
+			const double f = A[P*i+c]/A[P*c+c];
+			for (size_t k=c; k<P; ++k) A[P*i+k] -= f*A[P*c+k];
+			beta[i] -= f*beta[c];
+		}
+	}
+	for (size_t c=P; c-- > 0;) {
+		for (size_t k=c+1; k<P; ++k) beta[c] -= A[P*c+k]*beta[k];
+		beta[c] /= A[P*c+c];
+	}
+	double e = mc->mean[0], r = mc->M2[0];
+	for (size_t i=0; i<P; ++i) {
+		e -= beta[i]*(mc->mean[i+1]-mc->mu[i]);
+		r -= beta[i]*mc->M2[Q*(i+1)];         // residual sum of squares
+	}
+	const double var = r/((double)(mc->m-P-1)*(double)mc->m);
+	*est = e;
+	*se  = sqrt(var);
+	if (vc != NULL) *vc = var*mc->time;
+}
+
+// Integrate m samples (pairs of paths, if antithetic) of an SDE with additive noise sig[0 .. N-1], from
+// x0, n steps of size h (ODESTEP arguments as for ODESTEP; see ode.h); q(Y and controls) is evaluated at
+// the final state of each path by qfun(q,x,qarg), and accumulated into mc (omc_t*).
+
+#define OMCSDE(ode,odefun,N,h,n,x0,sig,m,mc,qfun,qarg,...) \
+{ \
+	const double tmc_ = omc_wtime(); \
+	const double sqh_ = sqrt(h); \
+	double xp_[N], xm_[N], sz_[N]; \
+	double qp_[(mc)->P+1], qm_[(mc)->P+1]; \
+	for (size_t i=0; i<N; ++i) sz_[i] = sqh_*(sig)[i]; \
+	for (size_t p_=0; p_<(m); ++p_) { \
+		memcpy(xp_,x0,N*sizeof(double)); \
+		if ((mc)->anti) { \
+			memcpy(xm_,x0,N*sizeof(double)); \
+			for (size_t k_=1; k_<(n); ++k_) { \
+				ODESTEP(ode,odefun,xp_,N,h,__VA_ARGS__); \
+				ODESTEP(ode,odefun,xm_,N,h,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) { \
+					const double dw_ = sz_[i]*(mc)->randn((mc)->rarg); \
+					xp_[i] += dw_; \
+					xm_[i] -= dw_; \
+				} \
+			} \
+			qfun(qp_,xp_,qarg); \
+			qfun(qm_,xm_,qarg); \
+			for (size_t i=0; i<=(mc)->P; ++i) qp_[i] = 0.5*(qp_[i]+qm_[i]); \
+			(mc)->npath += 2; \
+		} \
+		else { \
+			for (size_t k_=1; k_<(n); ++k_) { \
+				ODESTEP(ode,odefun,xp_,N,h,__VA_ARGS__); \
+				for (size_t i=0; i<N; ++i) xp_[i] += sz_[i]*(mc)->randn((mc)->rarg); \
+			} \
+			qfun(qp_,xp_,qarg); \
+			(mc)->npath += 1; \
+		} \
+		omc_add(mc,qp_); \
+		(mc)->nrand += ((n)-1)*N; \
+	} \
+	(mc)->time += omc_wtime()-tmc_; \
+}
+
+#endif // ODEMC_H
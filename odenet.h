@@ -0,0 +1,415 @@
+#ifndef ODENET_H
+#define ODENET_H
+
+// Sparse-coupled networks: coupling matrix storage and sparse matrix-vector product (SpMV) for the
+// right-hand side of large network models
+//
+// For a network of N nodes with sparse coupling W (w_ij = weight of the connection from node j to node
+// i), the RHS is typically local dynamics plus a coupling term (W x)_i, or diffusive coupling
+// sum_j w_ij (x_j-x_i) = (W x)_i - deg_i x_i. For large N the SpMV dominates and is memory-bound, so
+// storage format and node ordering matter more than arithmetic:
+//
+// - onet_build assembles W from an edge list into compressed sparse row (CSR) format, columns sorted
+//   within each row.
+// - onet_rcm computes a reverse Cuthill-McKee (RCM) ordering of the nodes, which reduces the matrix
+//   bandwidth, so that the x_j read for nearby rows are close in memory (cache reuse); onet_permute
+//   relabels the network accordingly, and onet_gather/onet_scatter permute state vectors.
+// - onet_sell builds SELL-C-sigma storage (ONET_C rows per chunk, stored column-major, with rows sorted
+//   by length within windows of sigma rows to minimise padding); its SpMV processes ONET_C rows in
+//   lock-step, which gives independent accumulations (and vectorises where gathers are available, e.g.
+//   with -mavx2).
+//
+// onet_spmv uses SELL-C-sigma storage if built, else CSR. E.g., for a network of bistable nodes with
+// diffusive coupling strength g, integrated with ODE/ODESTEP (see ode.h):
+//
+//   	static inline void netfun(double* const xdot, const double* const x, const onet_t* const W, const double g)
+//   	{
+//   		onet_spmv(W,x,xdot);
+//   		for (size_t i=0; i<W->N; ++i) xdot[i] = x[i]-x[i]*x[i]*x[i]+g*(xdot[i]-W->deg[i]*x[i]);
+//   	}
+//
+//   	onet_t W;
+//   	onet_build(&W,N,nnz,row,col,w);
+//   	uint32_t* const perm = malloc(N*sizeof(uint32_t));
+//   	onet_rcm(&W,perm);
+//   	onet_permute(&W,perm);              // node i is former node perm[i]
+//   	onet_sell(&W,256);
+//   	onet_gather(x,x0,perm,N);           // initial state in the new ordering
+//   	// ... integrate
+//   	onet_scatter(y,x,perm,N);           // state in the original ordering
+//
+// RCM operates on the sparsity pattern of W as given (out-edges); it is intended for (structurally)
+// symmetric networks. For others the ordering is a heuristic (nodes are only reached along out-edges, and
+// each unreached node starts a new traversal), but still a valid permutation.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef ONET_C
+#define ONET_C 8 // SELL-C-sigma chunk height (rows)
+#endif
+
+typedef struct {
+	size_t    N;     // number of nodes
+	size_t    nnz;   // number of connections
+	size_t*   rp;    // CSR row pointers (N+1)
+	uint32_t* ci;    // CSR column indices (nnz)
+	double*   w;     // CSR weights (nnz)
+	double*   deg;   // weighted in-degrees (row sums of W)
+	size_t    nch;   // SELL-C-sigma chunks (0 if not built)
+	size_t*   cp;    // SELL-C-sigma chunk offsets (nch+1)
+	uint32_t* sci;   // SELL-C-sigma column indices
+	double*   sw;    // SELL-C-sigma weights (0 for padding)
+	uint32_t* srow;  // SELL-C-sigma row of each chunk lane (nch*ONET_C)
+} onet_t;
+
+static inline void onet_free(onet_t* const W)
+{
+	free(W->rp);
+	free(W->ci);
+	free(W->w);
+	free(W->deg);
+	free(W->cp);
+	free(W->sci);
+	free(W->sw);
+	free(W->srow);
+	memset(W,0,sizeof(onet_t));
+}
+
+static inline int onet_alloc(onet_t* const W, const size_t N, const size_t nnz)
+{
+	memset(W,0,sizeof(onet_t));
+	W->N   = N;
+	W->nnz = nnz;
+	W->rp  = malloc((N+1)*sizeof(size_t));
+	W->ci  = malloc((nnz > 0 ? nnz : 1)*sizeof(uint32_t));
+	W->w   = malloc((nnz > 0 ? nnz : 1)*sizeof(double));
+	W->deg = malloc((N > 0 ? N : 1)*sizeof(double));
+	if (W->rp == NULL || W->ci == NULL || W->w == NULL || W->deg == NULL) {
+		onet_free(W);
+		return -1;
+	}
+	return 0;
+}
+
+// Row sums of W
+
+static inline void onet_degrees(onet_t* const W)
+{
+	for (size_t i=0; i<W->N; ++i) {
+		double s = 0.0;
+		for (size_t k=W->rp[i]; k<W->rp[i+1]; ++k) s += W->w[k];
+		W->deg[i] = s;
+	}
+}
+
+// Sort the columns of each row (insertion sort: rows are short)
+
+static inline void onet_sortrows(onet_t* const W)
+{
+	for (size_t i=0; i<W->N; ++i) {
+		for (size_t k=W->rp[i]+1; k<W->rp[i+1]; ++k) {
+			const uint32_t c = W->ci[k];
+			const double   v = W->w[k];
+			size_t m = k;
+			for (; m > W->rp[i] && W->ci[m-1] > c; --m) {
+				W->ci[m] = W->ci[m-1];
+				W->w[m]  = W->w[m-1];
+			}
+			W->ci[m] = c;
+			W->w[m]  = v;
+		}
+	}
+}
+
+// Build an N-node network (CSR) from nnz connections row[k] <- col[k] with weights w[k] (w may be NULL
+// for unit weights; repeated connections are kept, i.e. their weights add); returns 0 on success, -1
+// on failure
+
+static inline int onet_build(onet_t* const W, const size_t N, const size_t nnz, const uint32_t* const row, const uint32_t* const col, const double* const w)
+{
+	if (onet_alloc(W,N,nnz) != 0) return -1;
+	memset(W->rp,0,(N+1)*sizeof(size_t));
+	for (size_t k=0; k<nnz; ++k) ++W->rp[row[k]+1]; // counting sort by row
+	for (size_t i=0; i<N; ++i) W->rp[i+1] += W->rp[i];
+	size_t* const pos = malloc((N > 0 ? N : 1)*sizeof(size_t));
+	if (pos == NULL) {
+		onet_free(W);
+		return -1;
+	}
+	memcpy(pos,W->rp,N*sizeof(size_t));
+	for (size_t k=0; k<nnz; ++k) {
+		const size_t m = pos[row[k]]++;
+		W->ci[m] = col[k];
+		W->w[m]  = w == NULL ? 1.0 : w[k];
+	}
+	free(pos);
+	onet_sortrows(W);
+	onet_degrees(W);
+	return 0;
+}
+
+// Bandwidth (maximum |i-j| over connections)
+
+static inline size_t onet_bandwidth(const onet_t* const W)
+{
+	size_t b = 0;
+	for (size_t i=0; i<W->N; ++i) {
+		for (size_t k=W->rp[i]; k<W->rp[i+1]; ++k) {
+			const size_t j = W->ci[k], d = i > j ? i-j : j-i;
+			if (d > b) b = d;
+		}
+	}
+	return b;
+}
+
+// Number of connections of node i (row length)
+
+static inline size_t onet_len(const onet_t* const W, const size_t i)
+{
+	return W->rp[i+1]-W->rp[i];
+}
+
+// Breadth-first traversal from node s into q (neighbours visited in order of increasing degree), marking
+// visited nodes with tag, and skipping nodes already ordered (done[j] != 0; done may be NULL); returns
+// the number of nodes reached, with the eccentricity of s and the start of the last level in q
+
+static inline size_t onet_bfs(const onet_t* const W, const uint32_t s, uint32_t* const q, uint32_t* const mark, const uint8_t* const done, const uint32_t tag, size_t* const ecc, size_t* const last)
+{
+	size_t head = 0, tail = 0, lvlend = 1;
+	*ecc  = 0;
+	*last = 0;
+	q[tail++] = s;
+	mark[s] = tag;
+	while (head < tail) {
+		const uint32_t i = q[head++];
+		const size_t t0 = tail;
+		for (size_t k=W->rp[i]; k<W->rp[i+1]; ++k) {
+			const uint32_t j = W->ci[k];
+			if (mark[j] != tag && (done == NULL || !done[j])) {
+				mark[j] = tag;
+				q[tail++] = j;
+			}
+		}
+		for (size_t m=t0+1; m<tail; ++m) { // insertion sort by degree (few neighbours)
+			const uint32_t j = q[m];
+			size_t p = m;
+			for (; p > t0 && onet_len(W,q[p-1]) > onet_len(W,j); --p) q[p] = q[p-1];
+			q[p] = j;
+		}
+		if (head == lvlend && head < tail) { // next level
+			lvlend = tail;
+			*last  = head;
+			++*ecc;
+		}
+	}
+	return tail;
+}
+
+// Reverse Cuthill-McKee ordering: perm[i] = node placed at position i. Each connected component is
+// traversed breadth-first from a pseudo-peripheral node (George-Liu: restart from a minimum-degree node
+// of the last level while the eccentricity grows); the final order is reversed. Returns 0 on success,
+// -1 on failure.
+
+static inline int onet_rcm(const onet_t* const W, uint32_t* const perm)
+{
+	const size_t N = W->N;
+	uint32_t* const mark = calloc(N > 0 ? N : 1,sizeof(uint32_t));
+	uint32_t* const q    = malloc((N > 0 ? N : 1)*sizeof(uint32_t));
+	uint8_t*  const done = calloc(N > 0 ? N : 1,1);
+	if (mark == NULL || q == NULL || done == NULL) {
+		free(mark);
+		free(q);
+		free(done);
+		return -1;
+	}
+	uint32_t tag = 0;
+	size_t np = 0;
+	for (size_t s0=0; s0<N; ++s0) {
+		if (done[s0]) continue;
+		uint32_t s = (uint32_t)s0;
+		size_t ecc, last, nc = onet_bfs(W,s,q,mark,done,++tag,&ecc,&last);
+		for (int it=0; it<8; ++it) {
+			uint32_t c = q[last];
+			for (size_t m=last+1; m<nc; ++m) if (onet_len(W,q[m]) < onet_len(W,c)) c = q[m];
+			size_t ecc1, last1;
+			nc = onet_bfs(W,c,q,mark,done,++tag,&ecc1,&last1);
+			if (ecc1 <= ecc) { // no further: traverse from s
+				nc = onet_bfs(W,s,q,mark,done,++tag,&ecc,&last);
+				break;
+			}
+			s    = c;
+			ecc  = ecc1;
+			last = last1;
+		}
+		for (size_t m=0; m<nc; ++m) {
+			done[q[m]] = 1;
+			perm[np+m] = q[m];
+		}
+		np += nc;
+	}
+	for (size_t i=0; i<N/2; ++i) { // reverse
+		const uint32_t t = perm[i];
+		perm[i] = perm[N-1-i];
+		perm[N-1-i] = t;
+	}
+	free(mark);
+	free(q);
+	free(done);
+	return 0;
+}
+
+// Relabel the nodes: node i becomes former node perm[i] (SELL-C-sigma storage is discarded, and must
+// be rebuilt); returns 0 on success, -1 on failure
+
+static inline int onet_permute(onet_t* const W, const uint32_t* const perm)
+{
+	const size_t N = W->N;
+	onet_t V;
+	uint32_t* const iperm = malloc((N > 0 ? N : 1)*sizeof(uint32_t));
+	if (iperm == NULL || onet_alloc(&V,N,W->nnz) != 0) {
+		free(iperm);
+		return -1;
+	}
+	for (size_t i=0; i<N; ++i) iperm[perm[i]] = (uint32_t)i;
+	V.rp[0] = 0;
+	for (size_t i=0; i<N; ++i) {
+		const size_t i0 = perm[i], n = W->rp[i0+1]-W->rp[i0];
+		for (size_t k=0; k<n; ++k) {
+			V.ci[V.rp[i]+k] = iperm[W->ci[W->rp[i0]+k]];
+			V.w [V.rp[i]+k] = W->w[W->rp[i0]+k];
+		}
+		V.rp[i+1] = V.rp[i]+n;
+	}
+	free(iperm);
+	onet_sortrows(&V);
+	onet_degrees(&V);
+	onet_free(W);
+	*W = V;
+	return 0;
+}
+
+// Permute a state vector into the new ordering (y[i] = x[perm[i]]), or back (y[perm[i]] = x[i])
+
+static inline void onet_gather(double* const y, const double* const x, const uint32_t* const perm, const size_t N)
+{
+	for (size_t i=0; i<N; ++i) y[i] = x[perm[i]];
+}
+
+static inline void onet_scatter(double* const y, const double* const x, const uint32_t* const perm, const size_t N)
+{
+	for (size_t i=0; i<N; ++i) y[perm[i]] = x[i];
+}
+
+// Build SELL-C-sigma storage (from CSR), with rows sorted by length within windows of sigma rows
+// (sigma = 1 for no sorting, which keeps the row order, and hence the locality of x accesses, but pads
+// more); returns 0 on success, -1 on failure
+
+static inline int onet_sell(onet_t* const W, const size_t sigma)
+{
+	const size_t N = W->N, C = ONET_C, nch = (N+C-1)/C;
+	free(W->cp);
+	free(W->sci);
+	free(W->sw);
+	free(W->srow);
+	W->nch  = 0;
+	W->sci  = NULL;
+	W->sw   = NULL;
+	W->cp   = malloc((nch+1)*sizeof(size_t));
+	W->srow = malloc((nch > 0 ? nch*C : 1)*sizeof(uint32_t));
+	if (W->cp == NULL || W->srow == NULL) goto fail;
+	for (size_t i=0; i<nch*C; ++i) W->srow[i] = (uint32_t)(i < N ? i : N-1); // padding lanes repeat the last row
+	const size_t sg = sigma > 0 ? sigma : 1;
+	for (size_t b=0; b<N; b += sg) { // sort rows by decreasing length within each window (insertion sort, stable)
+		const size_t e = b+sg < N ? b+sg : N;
+		for (size_t m=b+1; m<e; ++m) {
+			const uint32_t r = W->srow[m];
+			const size_t len = onet_len(W,r);
+			size_t p = m;
+			for (; p > b && onet_len(W,W->srow[p-1]) < len; --p) W->srow[p] = W->srow[p-1];
+			W->srow[p] = r;
+		}
+	}
+	W->cp[0] = 0;
+	for (size_t c=0; c<nch; ++c) {
+		size_t wd = 0;
+		for (size_t r=0; r<C && c*C+r<N; ++r) {
+			const uint32_t i = W->srow[c*C+r];
+			if (onet_len(W,i) > wd) wd = onet_len(W,i);
+		}
+		W->cp[c+1] = W->cp[c]+wd*C;
+	}
+	const size_t ns = W->cp[nch];
+	W->sci = malloc((ns > 0 ? ns : 1)*sizeof(uint32_t));
+	W->sw  = malloc((ns > 0 ? ns : 1)*sizeof(double));
+	if (W->sci == NULL || W->sw == NULL) goto fail;
+	for (size_t c=0; c<nch; ++c) {
+		const size_t wd = (W->cp[c+1]-W->cp[c])/C;
+		for (size_t r=0; r<C; ++r) {
+			const uint32_t i = W->srow[c*C+r];
+			const size_t n = c*C+r < N ? onet_len(W,i) : 0;
+			for (size_t k=0; k<wd; ++k) {
+				const size_t m = W->cp[c]+k*C+r;
+				W->sci[m] = k < n ? W->ci[W->rp[i]+k] : i; // padding: zero weight, own column (cached)
+				W->sw[m]  = k < n ? W->w[W->rp[i]+k] : 0.0;
+			}
+		}
+	}
+	W->nch = nch;
+	return 0;
+
+fail:
+	free(W->cp);
+	free(W->sci);
+	free(W->sw);
+	free(W->srow);
+	W->cp   = NULL;
+	W->sci  = NULL;
+	W->sw   = NULL;
+	W->srow = NULL;
+	return -1;
+}
+
+// y = W x (CSR)
+
+static inline void onet_spmv_csr(const onet_t* const W, const double* const restrict x, double* const restrict y)
+{
+	const size_t* const rp = W->rp;
+	const uint32_t* const ci = W->ci;
+	const double* const w = W->w;
+	for (size_t i=0; i<W->N; ++i) {
+		double s = 0.0;
+		for (size_t k=rp[i]; k<rp[i+1]; ++k) s += w[k]*x[ci[k]];
+		y[i] = s;
+	}
+}
+
+// y = W x (SELL-C-sigma; must have been built)
+
+static inline void onet_spmv_sell(const onet_t* const W, const double* const restrict x, double* const restrict y)
+{
+	const size_t N = W->N;
+	for (size_t c=0; c<W->nch; ++c) {
+		double s[ONET_C] = {0.0};
+		const uint32_t* const ci = W->sci+W->cp[c];
+		const double*   const w  = W->sw +W->cp[c];
+		const size_t wd = (W->cp[c+1]-W->cp[c])/ONET_C;
+		for (size_t k=0; k<wd; ++k) {
+			for (size_t r=0; r<ONET_C; ++r) s[r] += w[k*ONET_C+r]*x[ci[k*ONET_C+r]];
+		}
+		const uint32_t* const row = W->srow+c*ONET_C;
+		const size_t nr = N-c*ONET_C < ONET_C ? N-c*ONET_C : ONET_C;
+		for (size_t r=0; r<nr; ++r) y[row[r]] = s[r];
+	}
+}
+
+// y = W x
+
+static inline void onet_spmv(const onet_t* const W, const double* const restrict x, double* const restrict y)
+{
+	if (W->nch > 0) onet_spmv_sell(W,x,y);
+	else onet_spmv_csr(W,x,y);
+}
+
+#endif // ODENET_H
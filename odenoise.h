@@ -0,0 +1,229 @@
+#ifndef ODENOISE_H
+#define ODENOISE_H
+
+// Noise sources for SDEs: correlated multivariate (white) noise, and coloured (OU and 1/f) noise
+//
+// Correlated noise, with covariance factored once (Cholesky)
+//
+// For an N-variable SDE driven by Wiener noise with covariance matrix V (dW dW^T = V dt), each noise
+// increment is L z sqrt(h), with z i.i.d. standard normal and V = L L^T. Rather than a matrix-vector
+// product per step, onoise_apply transforms a block of m steps at once (an m x N by N x N triangular
+// matrix-matrix product), in blocks of ONOISE_ROWS rows sharing each row of L^T, so that the factor
+// stays in cache and the inner loop is a vectorisable multiply-add over variables.
+//
+// Noise is transformed in place: the caller fills rows with i.i.d. standard normal variates (from any
+// generator), and onoise_apply leaves correlated increments. For the ODE macros, with the noise prefilled
+// in x (see ode.h):
+//
+//   	onoise_t c;
+//   	onoise_init(&c,N,V);                 // V is N x N (row-major), symmetric positive-definite
+//   	for (size_t k=N; k<N*n; ++k) x[k] = mt_randn(&rng);
+//   	onoise_apply(&c,x+N,n-1,sqrt(h));    // rows 1 .. n-1: increments with covariance V h
+//   	ODE(solver,odefun,x,N,n,h,...);
+//   	onoise_free(&c);
+//
+// For streaming integration (ODESTEP), fill and transform a buffer of B rows every B steps, and add one
+// row after each step.
+//
+// Coloured noise, generated step by step alongside the integration
+//
+// ocn_ou generates M independent Ornstein-Uhlenbeck processes (time constant tau, stationary standard
+// deviation sig) by the exact recursion u <- a u + sig sqrt(1-a^2) z, a = exp(-h/tau), which has no
+// discretisation error for any step size h. ocn_pink approximates 1/f^alpha noise (0 <= alpha <= 2) by a
+// sum of K OU processes with time constants log-spaced over [taumin,taumax] and variances proportional
+// to tau^(alpha-1); the spectrum is then 1/f^alpha to within a ripple that decreases with the number of
+// processes per decade, between frequencies ~ 1/(2 pi taumax) and 1/(2 pi taumin) (flat below, 1/f^2
+// above). The noise is held over each step, and passed to the ODE function as a parameter:
+//
+//   	ocn_t c;
+//   	ocn_pink(&c,M,1.0,taumin,taumax,K,sig,h,NULL);
+//   	double z[ocn_nz(&c)];
+//   	for (size_t k=1; k<n; ++k) {
+//   		for (size_t i=0; i<ocn_nz(&c); ++i) z[i] = mt_randn(&rng);
+//   		ocn_step(&c,z);                  // noise c.u[0 .. M-1] for this step
+//   		ODESTEP(solver,odefun,x,N,h,c.u);
+//   	}
+//   	ocn_free(&c);
+//
+// Only the current state of the noise processes is held, so no noise arrays are materialised; the
+// update is a vectorisable loop over the M*K processes.
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#ifndef ONOISE_ROWS
+#define ONOISE_ROWS 4 // rows transformed together
+#endif
+
+typedef struct {
+	size_t  N;  // number of variables
+	double* U;  // Cholesky factor, transposed (upper triangle of N x N, U = L^T)
+	double* z;  // scratch (ONOISE_ROWS x N)
+} onoise_t;
+
+// Factor the covariance matrix V (N x N, row-major; only the lower triangle is referenced); returns 0
+// on success, -1 on failure (errno = EDOM if V is not positive-definite)
+
+static inline int onoise_init(onoise_t* const c, const size_t N, const double* const V)
+{
+	c->N = N;
+	c->U = calloc(N*N+ONOISE_ROWS*N,sizeof(double));
+	if (c->U == NULL) return -1;
+	c->z = c->U+N*N;
+	double* const U = c->U;
+	for (size_t j=0; j<N; ++j) { // Cholesky-Banachiewicz, L[i][j] stored as U[j][i]
+		for (size_t i=j; i<N; ++i) {
+			double s = V[N*i+j];
+			for (size_t k=0; k<j; ++k) s -= U[N*k+i]*U[N*k+j];
+			if (i == j) {
+				if (!(s > 0.0)) {
+					free(c->U);
+					c->U = c->z = NULL;
+					errno = EDOM;
+					return -1;
+				}
+				U[N*j+j] = sqrt(s);
+			}
+			else {
+				U[N*j+i] = s/U[N*j+j];
+			}
+		}
+	}
+	return 0;
+}
+
+static inline void onoise_free(onoise_t* const c)
+{
+	free(c->U);
+	c->U = c->z = NULL;
+}
+
+// Transform m rows of x (m x N, i.i.d. standard normal on entry) in place to s L z (covariance s^2 V)
+
+static inline void onoise_apply(onoise_t* const c, double* const x, const size_t m, const double s)
+{
+	const size_t N = c->N, R = ONOISE_ROWS;
+	const double* const U = c->U;
+	double* const z = c->z;
+	size_t k = 0;
+	for (; k+R <= m; k += R) {
+		double* const y = x+N*k;
+		for (size_t r=0; r<R; ++r) {
+			for (size_t i=0; i<N; ++i) z[N*r+i] = s*y[N*r+i];
+		}
+		memset(y,0,R*N*sizeof(double));
+		for (size_t j=0; j<N; ++j) { // y_r += z_r[j] * (row j of U), for R rows at once
+			const double* const Uj = U+N*j;
+			double zj[ONOISE_ROWS];
+			for (size_t r=0; r<R; ++r) zj[r] = z[N*r+j];
+			for (size_t i=j; i<N; ++i) {
+				for (size_t r=0; r<R; ++r) y[N*r+i] += zj[r]*Uj[i];
+			}
+		}
+	}
+	for (; k<m; ++k) { // remaining rows
+		double* const y = x+N*k;
+		for (size_t i=0; i<N; ++i) z[i] = s*y[i];
+		memset(y,0,N*sizeof(double));
+		for (size_t j=0; j<N; ++j) {
+			const double* const Uj = U+N*j;
+			const double zj = z[j];
+			for (size_t i=j; i<N; ++i) y[i] += zj*Uj[i];
+		}
+	}
+}
+
+// Coloured noise: M channels, each a sum of K OU processes
+
+typedef struct {
+	size_t  M; // number of channels
+	size_t  K; // OU processes per channel
+	double* a; // OU decay factors per step (K)
+	double* b; // OU noise scale factors (K)
+	double* y; // OU processes (K x M)
+	double* u; // noise (M)
+} ocn_t;
+
+static inline void ocn_free(ocn_t* const c)
+{
+	free(c->a);
+	c->a = c->b = c->y = c->u = NULL;
+}
+
+// Number of standard normal variates required per step (and for initialisation)
+
+static inline size_t ocn_nz(const ocn_t* const c)
+{
+	return c->M*c->K;
+}
+
+// Set up M channels of K OU processes with time constants tau[0 .. K-1] and stationary standard
+// deviations s[0 .. K-1], at step size h; initial state s z0 (stationary) or zero if z0 is NULL.
+// Returns 0 on success, -1 on failure.
+
+static inline int ocn_init(ocn_t* const c, const size_t M, const size_t K, const double* const tau, const double* const s, const double h, const double* const z0)
+{
+	c->M = M;
+	c->K = K;
+	c->a = malloc((2*K+(K+1)*M)*sizeof(double));
+	if (c->a == NULL) return -1;
+	c->b = c->a+K;
+	c->y = c->b+K;
+	c->u = c->y+K*M;
+	for (size_t k=0; k<K; ++k) {
+		c->a[k] = exp(-h/tau[k]);
+		c->b[k] = s[k]*sqrt(1.0-c->a[k]*c->a[k]);
+		for (size_t i=0; i<M; ++i) c->y[M*k+i] = z0 == NULL ? 0.0 : s[k]*z0[M*k+i];
+	}
+	for (size_t i=0; i<M; ++i) {
+		double v = 0.0;
+		for (size_t k=0; k<K; ++k) v += c->y[M*k+i];
+		c->u[i] = v;
+	}
+	return 0;
+}
+
+// M channels of OU noise, time constant tau, stationary standard deviation sig
+
+static inline int ocn_ou(ocn_t* const c, const size_t M, const double tau, const double sig, const double h, const double* const z0)
+{
+	return ocn_init(c,M,1,&tau,&sig,h,z0);
+}
+
+// M channels of approximate 1/f^alpha noise (K OU processes per channel over [taumin,taumax]), total
+// standard deviation sig
+
+static inline int ocn_pink(ocn_t* const c, const size_t M, const double alpha, const double taumin, const double taumax, const size_t K, const double sig, const double h, const double* const z0)
+{
+	double tau[K], s[K], w = 0.0;
+	for (size_t k=0; k<K; ++k) {
+		tau[k] = K > 1 ? taumin*pow(taumax/taumin,(double)k/(double)(K-1)) : taumin;
+		s[k]   = pow(tau[k],alpha-1.0);
+		w     += s[k];
+	}
+	for (size_t k=0; k<K; ++k) s[k] = sig*sqrt(s[k]/w);
+	return ocn_init(c,M,K,tau,s,h,z0);
+}
+
+// Advance the noise by one step, with z[0 .. M*K-1] standard normal variates; returns the noise u
+
+static inline const double* ocn_step(ocn_t* const c, const double* const z)
+{
+	const size_t M = c->M, K = c->K;
+	double* const restrict u = c->u;
+	for (size_t i=0; i<M; ++i) u[i] = 0.0;
+	for (size_t k=0; k<K; ++k) {
+		const double ak = c->a[k], bk = c->b[k];
+		double* const restrict yk = c->y+M*k;
+		const double* const restrict zk = z+M*k;
+		for (size_t i=0; i<M; ++i) {
+			yk[i] = ak*yk[i]+bk*zk[i];
+			u[i] += yk[i];
+		}
+	}
+	return u;
+}
+
+#endif // ODENOISE_H
@@ -0,0 +1,381 @@
+#ifndef ODEPLOT_H
+#define ODEPLOT_H
+
+// Streaming downsampling of trajectories for plotting, with output in Gnuplot's binary format
+//
+// Plots against time (oplot_open): the run of n rows is divided into nbuckets buckets of consecutive rows
+// (nbuckets of the order of the plot width in pixels). For each bucket the first and last rows, and the
+// rows at which each plotted variable attains its minimum and maximum, are kept ("M4" downsampling), in
+// time order; a line plot of the downsampled series against time is then visually indistinguishable
+// from a plot of the full series, but has at most 2*(ncols+1) points per bucket, regardless of run
+// length.
+//
+// M4 is only faithful for plots against time: in a phase portrait (variables plotted against each other)
+// the rows between the kept ones define the curve. For those (oplot_open_phase) a row is kept when it
+// has moved by more than res (of the order of the plot extent divided by its width in pixels) in any
+// plotted variable since the last kept row, and the last row is always kept; the curve is then drawn to
+// within res, with a number of points proportional to its length in the plot rather than to the run
+// length.
+//
+// Each output record is the time followed by the ncols plotted variables, as native doubles, to be
+// plotted with e.g.
+//
+//   	plot "file" binary format="%2float64" u 1:2 w l      (one variable against time: M4)
+//   	splot "file" binary format="%4float64" u 2:3:4 w l   (phase portrait of three variables)
+//
+// (see oplot_format).
+//
+// Live plotting (olive_*): decimated states are streamed to a Gnuplot process through a popen pipe
+// during integration. Every decim-th state is added to a sliding window of the most recent W points,
+// and at most one frame per 'interval' seconds is sent (inline data). The pipe is non-blocking: if
+// Gnuplot has not yet consumed the previous frame, the remainder of that frame is sent when possible,
+// and new frames are dropped (counted) rather than stalling the integration.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+
+#include "odefmt.h"
+
+typedef struct {
+	FILE*   fs;       // output stream (opened and closed by the caller)
+	size_t  ncols;    // number of plotted variables
+	size_t* cols;     // plotted variables
+	size_t  bsize;    // rows per bucket
+	size_t  k;        // rows in current bucket
+	size_t  kk;       // total rows
+	size_t  nout;     // records written
+	size_t* idx;      // row indices of kept rows: first, last, then (min,max) per variable
+	double* rec;      // kept records (2*(ncols+1) x (ncols+1)); phase plots: last kept, current
+	double  res;      // phase plot resolution (0 for M4)
+	int     err;      // write error
+} oplot_t;
+
+// Set up for n rows, downsampled into nbuckets buckets, plotting variables cols[0 .. ncols-1];
+// returns 0 on success, -1 on failure (errno is set)
+
+static inline int oplot_open(oplot_t* const p, FILE* const fs, const size_t* const cols, const size_t ncols, const size_t n, const size_t nbuckets)
+{
+	const size_t m = 2*(ncols+1), r = ncols+1;
+	p->fs    = fs;
+	p->ncols = ncols;
+	p->bsize = nbuckets > 0 && n > nbuckets ? (n+nbuckets-1)/nbuckets : 1;
+	p->k     = 0;
+	p->kk    = 0;
+	p->nout  = 0;
+	p->err   = 0;
+	p->res   = 0.0;
+	p->cols  = malloc((ncols+m)*sizeof(size_t));
+	p->rec   = malloc(m*r*sizeof(double));
+	if (p->cols == NULL || p->rec == NULL) {
+		free(p->cols);
+		free(p->rec);
+		return -1;
+	}
+	p->idx = p->cols+ncols;
+	memcpy(p->cols,cols,ncols*sizeof(size_t));
+	return 0;
+}
+
+// Set up for a phase plot of variables cols[0 .. ncols-1], at resolution res > 0; returns 0 on success,
+// -1 on failure (errno is set)
+
+static inline int oplot_open_phase(oplot_t* const p, FILE* const fs, const size_t* const cols, const size_t ncols, const double res)
+{
+	if (!(res > 0.0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (oplot_open(p,fs,cols,ncols,0,0) != 0) return -1;
+	p->res = res;
+	return 0;
+}
+
+// Gnuplot binary format specifier for the output records (s must have room for 32 characters)
+
+static inline void oplot_format(const oplot_t* const p, char* const s)
+{
+	snprintf(s,32,"%%%zufloat64",p->ncols+1);
+}
+
+// Write the kept rows of the current bucket, in time order, without duplicates
+
+static inline void oplot_flush(oplot_t* const p)
+{
+	const size_t m = 2*(p->ncols+1), r = p->ncols+1;
+	if (p->k == 0) return;
+	if (p->res > 0.0) { // phase plot: current row, if not kept
+		if (fwrite(p->rec+r,sizeof(double),r,p->fs) != r) p->err = 1;
+		++p->nout;
+		p->k = 0;
+		return;
+	}
+	size_t last = (size_t)-1;
+	for (;;) { // selection of next smallest row index (m is small)
+		size_t jmin = m;
+		for (size_t j=0; j<m; ++j) {
+			if ((last == (size_t)-1 || p->idx[j] > last) && (jmin == m || p->idx[j] < p->idx[jmin])) jmin = j;
+		}
+		if (jmin == m) break;
+		last = p->idx[jmin];
+		if (fwrite(p->rec+r*jmin,sizeof(double),r,p->fs) != r) p->err = 1;
+		++p->nout;
+	}
+	p->k = 0;
+}
+
+// Feed the row x at time t
+
+static inline void oplot_update(oplot_t* const p, const double t, const double* const x)
+{
+	const size_t nc = p->ncols, r = nc+1, m = 2*r;
+	double* const rec = p->rec;
+	const size_t kk = p->kk++;
+	if (p->res > 0.0) { // phase plot: keep the row if it has moved by more than res
+		int keep = kk == 0;
+		for (size_t c=0; c<nc; ++c) keep |= fabs(x[p->cols[c]]-rec[1+c]) > p->res;
+		double* const q = rec+(keep ? 0 : r);
+		q[0] = t;
+		for (size_t c=0; c<nc; ++c) q[1+c] = x[p->cols[c]];
+		if (keep) {
+			if (fwrite(rec,sizeof(double),r,p->fs) != r) p->err = 1;
+			++p->nout;
+			p->k = 0;
+		}
+		else {
+			p->k = 1;
+		}
+		return;
+	}
+	if (p->k == 0) { // new bucket: current row is first, last, and extremal for all variables
+		rec[0] = t;
+		for (size_t c=0; c<nc; ++c) rec[1+c] = x[p->cols[c]];
+		for (size_t j=1; j<m; ++j) memcpy(rec+r*j,rec,r*sizeof(double));
+		for (size_t j=0; j<m; ++j) p->idx[j] = kk;
+	}
+	else {
+		int copy = 0;
+		for (size_t c=0; c<nc; ++c) {
+			const double y = x[p->cols[c]];
+			if (y < rec[r*(2+2*c)+1+c]) { p->idx[2+2*c] = kk; copy = 1; }
+			if (y > rec[r*(3+2*c)+1+c]) { p->idx[3+2*c] = kk; copy = 1; }
+		}
+		p->idx[1] = kk; // last
+		rec[r] = t;
+		for (size_t c=0; c<nc; ++c) rec[r+1+c] = x[p->cols[c]];
+		if (copy) for (size_t j=2; j<m; ++j) if (p->idx[j] == kk) memcpy(rec+r*j,rec+r,r*sizeof(double));
+	}
+	if (++p->k == p->bsize) oplot_flush(p);
+}
+
+// Flush the last (partial) bucket and free memory (the stream is not closed); returns 0 on success,
+// -1 if writing failed
+
+static inline int oplot_close(oplot_t* const p)
+{
+	oplot_flush(p);
+	free(p->cols);
+	free(p->rec);
+	p->cols = p->idx = NULL;
+	p->rec = NULL;
+	return p->err ? -1 : 0;
+}
+
+// Live plotting
+
+typedef struct {
+	FILE*   gp;       // Gnuplot pipe
+	int     fd;       // pipe file descriptor (non-blocking)
+	size_t  ncols;    // number of plotted variables (1: against time; 2: x-y plot; 3: 3D plot)
+	size_t  cols[3];  // plotted variables
+	size_t  W;        // window length (points)
+	size_t  decim;    // decimation (states per window point)
+	double  interval; // minimum interval between frames (seconds)
+	double  tlast;    // time of last frame
+	size_t  kd;       // states since last window point
+	size_t  pos;      // next window slot
+	size_t  nw;       // points in window
+	double* win;      // window (W x (ncols+1): time, then variables)
+	char*   frame;    // frame buffer
+	size_t  fsiz;     // frame buffer size
+	size_t  fpos;     // bytes of current frame already sent
+	size_t  flen;     // length of current frame (0 if none pending)
+	size_t  nframes;  // frames sent
+	size_t  ndropped; // frames dropped
+} olive_t;
+
+static inline double olive_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec+1e-9*(double)ts.tv_nsec;
+}
+
+// SIGPIPE is blocked (in the calling thread) around writes to the pipe, and a SIGPIPE raised by them is
+// discarded before the signal mask is restored, so that a closed Gnuplot window shows up as a write
+// error rather than terminating the program, without changing the host program's signal handling
+
+static inline void olive_sigblock(sigset_t* const old)
+{
+	sigset_t s;
+	sigemptyset(&s);
+	sigaddset(&s,SIGPIPE);
+	pthread_sigmask(SIG_BLOCK,&s,old);
+}
+
+static inline void olive_sigrestore(const sigset_t* const old)
+{
+	const int e = errno;
+	sigset_t s;
+	sigpending(&s);
+	if (sigismember(&s,SIGPIPE) && !sigismember(old,SIGPIPE)) { // raised by our write: discard
+		static const struct timespec zero = {0,0};
+		sigemptyset(&s);
+		sigaddset(&s,SIGPIPE);
+		while (sigtimedwait(&s,NULL,&zero) < 0 && errno == EINTR);
+	}
+	pthread_sigmask(SIG_SETMASK,old,NULL);
+	errno = e;
+}
+
+// Start Gnuplot (command gpcmd, e.g. "gnuplot") and send the setup commands (may be NULL); returns 0
+// on success, -1 on failure (errno is set)
+
+static inline int olive_open(olive_t* const p, const char* const gpcmd, const size_t* const cols, const size_t ncols, const size_t W, const size_t decim, const double interval, const char* const setup)
+{
+	memset(p,0,sizeof(olive_t));
+	if (ncols < 1 || ncols > 3 || W < 2 || decim < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+	p->ncols    = ncols;
+	p->W        = W;
+	p->decim    = decim;
+	p->interval = interval;
+	p->tlast    = -interval;
+	memcpy(p->cols,cols,ncols*sizeof(size_t));
+	p->fsiz  = W*(ncols+1)*(1+OFMT_MAX(0,8))+64;
+	p->win   = malloc(W*(ncols+1)*sizeof(double));
+	p->frame = malloc(p->fsiz);
+	if (p->win == NULL || p->frame == NULL) {
+		free(p->win);
+		free(p->frame);
+		return -1;
+	}
+	p->gp = popen(gpcmd,"w");
+	if (p->gp == NULL) {
+		free(p->win);
+		free(p->frame);
+		return -1;
+	}
+	sigset_t old;
+	olive_sigblock(&old);
+	if (setup != NULL) {
+		fputs(setup,p->gp);
+		fputc('\n',p->gp);
+	}
+	fflush(p->gp);
+	olive_sigrestore(&old);
+	p->fd = fileno(p->gp);
+	fcntl(p->fd,F_SETFL,fcntl(p->fd,F_GETFL)|O_NONBLOCK);
+	return 0;
+}
+
+// Send as much of the pending frame as the pipe will take without blocking; returns 0, or -1 if
+// Gnuplot has gone away
+
+static inline int olive_send(olive_t* const p)
+{
+	int ret = 0;
+	sigset_t old;
+	olive_sigblock(&old);
+	while (p->fpos < p->flen) {
+		const ssize_t w = write(p->fd,p->frame+p->fpos,p->flen-p->fpos);
+		if (w < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			if (errno == EINTR) continue;
+			p->flen = p->fpos = 0;
+			p->fd = -1; // give up
+			ret = -1;
+			break;
+		}
+		p->fpos += (size_t)w;
+	}
+	if (p->fpos == p->flen) p->flen = p->fpos = 0;
+	olive_sigrestore(&old);
+	return ret;
+}
+
+// Build a frame from the current window
+
+static inline void olive_frame(olive_t* const p)
+{
+	const size_t r = p->ncols+1;
+	char* s = p->frame;
+	s += sprintf(s,p->ncols == 3 ? "splot '-' w l not\n" : "plot '-' w l not\n");
+	const size_t c0 = p->ncols == 1 ? 0 : 1; // plot time only for a single variable
+	for (size_t j=0, k = p->nw < p->W ? 0 : p->pos; j<p->nw; ++j, k = k+1 == p->W ? 0 : k+1) {
+		s += ofmt_row(s,p->win+r*k+c0,r-c0,0,8,0);
+	}
+	*s++ = 'e';
+	*s++ = '\n';
+	p->flen = (size_t)(s-p->frame);
+	p->fpos = 0;
+}
+
+// Feed the state x at time t
+
+static inline void olive_update(olive_t* const p, const double t, const double* const x)
+{
+	if (p->fd < 0 || ++p->kd < p->decim) return;
+	p->kd = 0;
+	const size_t r = p->ncols+1;
+	double* const w = p->win+r*p->pos;
+	w[0] = t;
+	for (size_t c=0; c<p->ncols; ++c) w[1+c] = x[p->cols[c]];
+	p->pos = p->pos+1 == p->W ? 0 : p->pos+1;
+	if (p->nw < p->W) ++p->nw;
+	if (p->flen > 0 && olive_send(p) != 0) return; // finish pending frame first
+	const double now = olive_clock();
+	if (now-p->tlast < p->interval) return;
+	p->tlast = now;
+	if (p->flen > 0) { // Gnuplot still busy with the previous frame
+		++p->ndropped;
+		return;
+	}
+	olive_frame(p);
+	++p->nframes;
+	olive_send(p);
+}
+
+// Send the final frame (blocking) and close the pipe (Gnuplot is left running if started with -p);
+// returns 0 on success, -1 on failure
+
+static inline int olive_close(olive_t* const p)
+{
+	if (p->gp == NULL) return -1;
+	if (p->fd >= 0) fcntl(p->fd,F_SETFL,fcntl(p->fd,F_GETFL)&~O_NONBLOCK);
+	if (p->fd >= 0 && p->flen == 0 && p->nw > 0) {
+		olive_frame(p);
+		++p->nframes;
+	}
+	const int ret = p->fd >= 0 ? olive_send(p) : -1;
+	free(p->win);
+	free(p->frame);
+	p->win   = NULL;
+	p->frame = NULL;
+	sigset_t old;
+	olive_sigblock(&old); // (pclose flushes the stream)
+	const int cret = pclose(p->gp);
+	olive_sigrestore(&old);
+	return cret == -1 || ret != 0 ? -1 : 0;
+}
+
+#endif // ODEPLOT_H
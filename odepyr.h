@@ -0,0 +1,319 @@
+#ifndef ODEPYR_H
+#define ODEPYR_H
+
+// Multi-resolution min/max/mean trajectory pyramid, for zoomable visualisation of long runs
+//
+// Level 0 aggregates each f consecutive trajectory rows into one record, level 1 each f level-0
+// records, and so on up to a single record, so a viewer can fetch any time window at any zoom level
+// with a read of bounded size (see opyr_level). The pyramid is built in streaming fashion (one
+// accumulator per level, O(N*log(n)) memory), typically on the writer thread alongside the trajectory
+// file (see ow_binary_pyr).
+//
+// File layout: a 64-byte header, then the levels in order, each a contiguous array of records:
+//
+// Field    Description                              Type
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+// magic    "ODEPYR1" (NUL-terminated)               char[8]
+// N        number of variables                      uint64_t
+// n        number of trajectory rows aggregated     uint64_t
+// nlay     number of rows the layout was sized for  uint64_t
+// h        time increment between rows              double
+// t0       time of first row                        double
+// f        decimation factor per level              uint32_t
+// L        number of levels                         uint32_t
+// (pad)    zero                                     uint8_t[8]
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+//
+// Level l holds ceil(nlay/f^(l+1)) records of 3N doubles: minima, maxima and means of the N variables
+// over the (up to) f^(l+1) rows aggregated. The last record of each level may be partial.
+//
+// Functions returning int return 0 on success, or -1 on failure (errno is set where applicable).
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OPYR_MAGIC "ODEPYR1"
+
+typedef struct {
+	char     magic[8];
+	uint64_t N;
+	uint64_t n;
+	uint64_t nlay;
+	double   h;
+	double   t0;
+	uint32_t f;
+	uint32_t L;
+	uint8_t  pad[8];
+} opyr_hdr_t;
+
+_Static_assert(sizeof(opyr_hdr_t) == 64,"pyramid file header must be 64 bytes");
+
+// Number of levels and records per level for nlay rows
+
+static inline size_t opyr_levels(const size_t nlay, const size_t f)
+{
+	size_t L = 1;
+	for (size_t span=f; span < nlay; span *= f) ++L;
+	return L;
+}
+
+static inline size_t opyr_count(const size_t nlay, const size_t f, const size_t l)
+{
+	size_t span = f;
+	for (size_t j=0; j<l; ++j) span *= f;
+	return (nlay+span-1)/span;
+}
+
+// Pyramid builder
+
+#define OPYR_BUFREC 256 // records buffered per level before writing
+
+typedef struct {
+	int         fd;    // output file
+	opyr_hdr_t  hdr;   // header
+	size_t      N;     // number of variables
+	size_t      f;     // decimation factor
+	size_t      L;     // number of levels
+	size_t*     off;   // file offset of each level
+	size_t*     nrec;  // records emitted per level
+	size_t*     nacc;  // inputs in each level's accumulator
+	size_t*     nraw;  // trajectory rows in each level's accumulator
+	size_t*     bfill; // records in each level's write buffer
+	double*     acc;   // accumulators (L x 3N: min, max, sum)
+	double*     buf;   // write buffers (L x OPYR_BUFREC x 3N)
+	int         err;   // write error
+} opyr_t;
+
+// Create pyramid file for (up to) nlay rows of N variables, decimation factor f (at least 2)
+
+static inline int opyr_open(opyr_t* const p, const char* const path, const size_t N, const size_t nlay, const size_t f, const double h, const double t0)
+{
+	memset(p,0,sizeof(opyr_t));
+	if (N == 0 || nlay == 0 || f < 2) {
+		errno = EINVAL;
+		return -1;
+	}
+	const size_t L = opyr_levels(nlay,f), R = 3*N;
+	p->N = N;
+	p->f = f;
+	p->L = L;
+	memcpy(p->hdr.magic,OPYR_MAGIC,sizeof(OPYR_MAGIC));
+	p->hdr.N    = N;
+	p->hdr.nlay = nlay;
+	p->hdr.h    = h;
+	p->hdr.t0   = t0;
+	p->hdr.f    = (uint32_t)f;
+	p->hdr.L    = (uint32_t)L;
+	p->off = calloc(5*L,sizeof(size_t));
+	p->acc = malloc(L*R*(1+OPYR_BUFREC)*sizeof(double));
+	if (p->off == NULL || p->acc == NULL) {
+		free(p->off);
+		free(p->acc);
+		return -1;
+	}
+	p->nrec  = p->off+L;
+	p->nacc  = p->nrec+L;
+	p->nraw  = p->nacc+L;
+	p->bfill = p->nraw+L;
+	p->buf   = p->acc+L*R;
+	size_t off = sizeof(opyr_hdr_t);
+	for (size_t l=0; l<L; ++l) {
+		p->off[l] = off;
+		off += opyr_count(nlay,f,l)*R*sizeof(double);
+	}
+	p->fd = open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if (p->fd < 0) {
+		free(p->off);
+		free(p->acc);
+		return -1;
+	}
+	return 0;
+}
+
+static inline void opyr_bflush(opyr_t* const p, const size_t l)
+{
+	const size_t R = 3*p->N, nb = p->bfill[l]*R*sizeof(double);
+	if (nb == 0) return;
+	const off_t o = (off_t)(p->off[l]+(p->nrec[l]-p->bfill[l])*R*sizeof(double));
+	if (pwrite(p->fd,p->buf+OPYR_BUFREC*R*l,nb,o) != (ssize_t)nb) p->err = 1;
+	p->bfill[l] = 0;
+}
+
+// Aggregate min/max/sum over nraw rows into level l (propagating completed records upwards)
+
+static inline void opyr_add(opyr_t* const p, size_t l, const double* mn, const double* mx, const double* sm, size_t nraw, const int flush)
+{
+	const size_t N = p->N, R = 3*N;
+	while (l < p->L) {
+		double* const a = p->acc+R*l;
+		if (mn != NULL) {
+			if (p->nacc[l]++ == 0) {
+				memcpy(a,mn,N*sizeof(double));
+				memcpy(a+N,mx,N*sizeof(double));
+				memcpy(a+2*N,sm,N*sizeof(double));
+			}
+			else {
+				for (size_t i=0; i<N; ++i) {
+					a[i]     = mn[i] < a[i]   ? mn[i] : a[i];
+					a[N+i]   = mx[i] > a[N+i] ? mx[i] : a[N+i];
+					a[2*N+i] += sm[i];
+				}
+			}
+			p->nraw[l] += nraw;
+		}
+		if (p->nacc[l] == 0 || (p->nacc[l] < p->f && !flush)) return;
+		if (p->nrec[l] == opyr_count(p->hdr.nlay,p->f,l)) { // more rows than the layout allows
+			p->err = 1;
+			return;
+		}
+		double* const r = p->buf+R*(OPYR_BUFREC*l+p->bfill[l]);
+		const double rn = 1.0/(double)p->nraw[l];
+		memcpy(r,a,2*N*sizeof(double));
+		for (size_t i=0; i<N; ++i) r[2*N+i] = rn*a[2*N+i];
+		++p->nrec[l];
+		if (++p->bfill[l] == OPYR_BUFREC) opyr_bflush(p,l);
+		mn = a; mx = a+N; sm = a+2*N; // a is left intact until reset below
+		nraw = p->nraw[l];
+		p->nacc[l] = 0;
+		p->nraw[l] = 0;
+		++l;
+	}
+}
+
+// Feed a trajectory row x
+
+static inline void opyr_update(opyr_t* const p, const double* const x)
+{
+	++p->hdr.n;
+	opyr_add(p,0,x,x,x,1,0);
+}
+
+// Flush partial records, write the header and close the file
+
+static inline int opyr_close(opyr_t* const p)
+{
+	for (size_t l=0; l<p->L; ++l) opyr_add(p,l,NULL,NULL,NULL,0,1); // partial records, bottom up
+	for (size_t l=0; l<p->L; ++l) opyr_bflush(p,l);
+	if (pwrite(p->fd,&p->hdr,sizeof(opyr_hdr_t),0) != (ssize_t)sizeof(opyr_hdr_t)) p->err = 1;
+	if (close(p->fd) != 0) p->err = 1;
+	free(p->off);
+	free(p->acc);
+	p->off = p->nrec = p->nacc = p->nraw = p->bfill = NULL;
+	p->acc = p->buf = NULL;
+	return p->err ? -1 : 0;
+}
+
+// Asynchronous writer block function (see odewrite.h): write raw rows, and feed them to the pyramid
+// (arg is an opyr_t*)
+
+static inline int ow_binary_pyr(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+{
+	opyr_t* const p = arg;
+	for (size_t k=0; k<rows; ++k) opyr_update(p,blk+N*k);
+	if (p->err) return -1;
+	return fwrite(blk,sizeof(double),rows*N,fs) == rows*N ? 0 : -1;
+}
+
+// Pyramid reader (memory-mapped)
+
+typedef struct {
+	void*          map;    // file mapping
+	size_t         maplen; // mapping length
+	opyr_hdr_t     hdr;    // header
+	size_t         N;      // number of variables
+	size_t         f;      // decimation factor
+	size_t         L;      // number of levels
+	const double** lev;    // records of each level
+	size_t*        cnt;    // number of (valid) records of each level
+	size_t*        span;   // rows per record of each level
+} opyr_map_t;
+
+static inline int opyr_map(opyr_map_t* const m, const char* const path)
+{
+	memset(m,0,sizeof(opyr_map_t));
+	const int fd = open(path,O_RDONLY);
+	if (fd < 0) return -1;
+	struct stat st;
+	if (fstat(fd,&st) != 0 || (size_t)st.st_size < sizeof(opyr_hdr_t)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	m->maplen = (size_t)st.st_size;
+	m->map = mmap(NULL,m->maplen,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if (m->map == MAP_FAILED) {
+		m->map = NULL;
+		return -1;
+	}
+	memcpy(&m->hdr,m->map,sizeof(opyr_hdr_t));
+	m->N = m->hdr.N;
+	m->f = m->hdr.f;
+	m->L = m->hdr.L;
+	const size_t R = 3*m->N;
+	if (memcmp(m->hdr.magic,OPYR_MAGIC,sizeof(OPYR_MAGIC)) != 0 || m->N == 0 || m->f < 2 || m->hdr.n > m->hdr.nlay || m->L != opyr_levels(m->hdr.nlay,m->f)) goto invalid;
+	m->lev = malloc(m->L*sizeof(double*));
+	m->cnt = malloc(2*m->L*sizeof(size_t));
+	if (m->lev == NULL || m->cnt == NULL) goto fail;
+	m->span = m->cnt+m->L;
+	size_t off = sizeof(opyr_hdr_t), span = m->f;
+	for (size_t l=0; l<m->L; ++l, span *= m->f) {
+		m->lev[l]  = (const double*)((const char*)m->map+off);
+		m->cnt[l]  = (m->hdr.n+span-1)/span;
+		m->span[l] = span;
+		off += opyr_count(m->hdr.nlay,m->f,l)*R*sizeof(double);
+	}
+	if (off > m->maplen) goto invalid; // truncated
+	return 0;
+invalid:
+	errno = EINVAL;
+fail:
+	{
+		const int e = errno;
+		munmap(m->map,m->maplen);
+		free(m->lev);
+		free(m->cnt);
+		memset(m,0,sizeof(opyr_map_t));
+		errno = e;
+	}
+	return -1;
+}
+
+static inline void opyr_unmap(opyr_map_t* const m)
+{
+	if (m->map != NULL) munmap(m->map,m->maplen);
+	free(m->lev);
+	free(m->cnt);
+	memset(m,0,sizeof(opyr_map_t));
+}
+
+// Finest level at which the rows k0 .. k1-1 span at most maxrec records
+
+static inline size_t opyr_level(const opyr_map_t* const m, const size_t k0, const size_t k1, const size_t maxrec)
+{
+	size_t l = 0;
+	while (l+1 < m->L && (k1+m->span[l]-1)/m->span[l]-k0/m->span[l] > maxrec) ++l;
+	return l;
+}
+
+// Records of level l covering rows k0 .. k1-1: returns pointer to the first record (index *r0), and
+// the number of records in *nrec
+
+static inline const double* opyr_records(const opyr_map_t* const m, const size_t l, const size_t k0, const size_t k1, size_t* const r0, size_t* const nrec)
+{
+	const size_t s = m->span[l];
+	size_t r1 = (k1+s-1)/s;
+	*r0 = k0/s;
+	if (r1 > m->cnt[l]) r1 = m->cnt[l];
+	*nrec = r1 > *r0 ? r1-*r0 : 0;
+	return m->lev[l]+3*m->N*(*r0);
+}
+
+#endif // ODEPYR_H
@@ -0,0 +1,301 @@
+#ifndef ODEQMC_H
+#define ODEQMC_H
+
+// Quasi-Monte Carlo ensembles: scrambled Sobol sequences for initial conditions and (by Brownian bridge
+// construction) for SDE noise
+//
+// Ensemble averages over pseudo-random samples converge as O(1/sqrt(M)); over low-discrepancy (Sobol)
+// points, for smooth enough integrands of moderate effective dimension, nearly as O(1/M). Sobol points
+// are generated in Gray-code order (one XOR per coordinate per point), and osobol_skip jumps directly to
+// any index in O(log index), so that parallel chunks of an ensemble may each start at their own offset
+// and together produce exactly the points of a single sequence.
+//
+// Scrambling (random linear matrix scramble of the direction numbers plus a random digital shift,
+// Matousek) randomises the point set while preserving its equidistribution, so that independent
+// scrambles (different seeds) give unbiased estimates with an error estimate from their spread, and
+// avoids the degeneracies of the raw sequence (e.g. the point 0). Direction numbers: dimension 1 is the
+// van der Corput sequence; further dimensions use primitive polynomials mod 2 in order of degree, with
+// pseudo-random odd initial direction numbers (in place of optimised tables, which scrambling largely
+// compensates for at moderate dimension).
+//
+// For SDE noise, the D = N*n normal variates for an N-variable path of n steps are assigned by
+// Brownian bridge construction (obb_noise): the first coordinates of each point fix W(T), then the
+// midpoints, and so on, so that the large-scale path structure depends on the leading (best distributed)
+// Sobol coordinates. E.g., for initial conditions:
+//
+//   	osobol_t s;
+//   	osobol_init(&s,N,seed);
+//   	osobol_skip(&s,offset);              // this chunk's first point
+//   	for (size_t k=0; k<M; ++k) {
+//   		double u[N];
+//   		osobol_next(&s,u);               // u in (0,1)^N
+//   		// ... x0 from u, integrate, accumulate
+//   	}
+//   	osobol_free(&s);
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define OSOBOL_BITS 32 // bits per coordinate (up to 2^32 points)
+
+typedef struct {
+	size_t    D;     // dimension
+	uint32_t* v;     // (scrambled) direction numbers (D x OSOBOL_BITS)
+	uint32_t* shift; // digital shifts (D)
+	uint32_t* x;     // current point (D)
+	uint64_t  n;     // index of the current point
+} osobol_t;
+
+// Pseudo-random bits for scrambling (splitmix64)
+
+static inline uint64_t oqmc_mix(uint64_t* const state)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15);
+	z = (z^(z>>30))*0xbf58476d1ce4e5b9;
+	z = (z^(z>>27))*0x94d049bb133111eb;
+	return z^(z>>31);
+}
+
+// Is the polynomial p (degree d, bit k = coefficient of x^k) primitive mod 2? (x has order 2^d-1
+// modulo p)
+
+static inline uint64_t oqmc_mulmod(uint64_t a, uint64_t b, const uint64_t p, const unsigned d)
+{
+	uint64_t r = 0;
+	while (b) {
+		if (b&1) r ^= a;
+		b >>= 1;
+		a <<= 1;
+		if (a>>d) a ^= p;
+	}
+	return r;
+}
+
+static inline uint64_t oqmc_powmod(uint64_t e, const uint64_t p, const unsigned d)
+{
+	uint64_t r = 1, a = 2; // a = x
+	while (e) {
+		if (e&1) r = oqmc_mulmod(r,a,p,d);
+		a = oqmc_mulmod(a,a,p,d);
+		e >>= 1;
+	}
+	return r;
+}
+
+static inline int oqmc_primitive(const uint64_t p, const unsigned d)
+{
+	const uint64_t ord = ((uint64_t)1<<d)-1;
+	if (!(p&1) || oqmc_powmod(ord,p,d) != 1) return 0;
+	uint64_t m = ord;
+	for (uint64_t q=2; q*q<=m; ++q) { // prime factors q of the order
+		if (m%q) continue;
+		if (oqmc_powmod(ord/q,p,d) == 1) return 0;
+		while (m%q == 0) m /= q;
+	}
+	if (m > 1 && oqmc_powmod(ord/m,p,d) == 1) return 0; // remaining prime factor
+	return 1;
+}
+
+static inline void osobol_free(osobol_t* const s)
+{
+	free(s->v);
+	s->v = s->shift = s->x = NULL;
+}
+
+// Set up a D-dimensional Sobol sequence, scrambled with the given seed (seed = 0 for the unscrambled
+// sequence), positioned before the first point
+
+static inline int osobol_init(osobol_t* const s, const size_t D, const uint64_t seed)
+{
+	const unsigned B = OSOBOL_BITS;
+	s->D = D;
+	s->n = 0;
+	s->v = calloc(D*B+2*D,sizeof(uint32_t));
+	if (s->v == NULL) return -1;
+	s->shift = s->v+D*B;
+	s->x     = s->shift+D;
+	uint64_t rs = 0x5eed5eed5eed5eed; // initial direction numbers (fixed)
+	uint64_t p = 1;
+	unsigned d = 0;
+	for (size_t j=0; j<D; ++j) {
+		uint32_t* const v = s->v+B*j;
+		if (j == 0) { // van der Corput
+			for (unsigned k=0; k<B; ++k) v[k] = (uint32_t)1<<(B-1-k);
+			continue;
+		}
+		do { // next primitive polynomial
+			p += 2;
+			if (p>>(d+1)) {
+				++d;
+				p = ((uint64_t)1<<d)|1;
+			}
+		} while (!oqmc_primitive(p,d));
+		for (unsigned k=0; k<d && k<B; ++k) { // odd m_k < 2^(k+1)
+			const uint32_t m = (uint32_t)(oqmc_mix(&rs)&(((uint64_t)1<<(k+1))-1))|1;
+			v[k] = m<<(B-1-k);
+		}
+		for (unsigned k=d; k<B; ++k) { // recurrence
+			uint32_t w = v[k-d]^(v[k-d]>>d);
+			for (unsigned i=1; i<d; ++i) if ((p>>(d-i))&1) w ^= v[k-i];
+			v[k] = w;
+		}
+	}
+	if (seed != 0) { // linear matrix scramble (random lower-triangular, unit diagonal) and digital shift
+		uint64_t ss = seed;
+		for (size_t j=0; j<D; ++j) {
+			uint32_t L[OSOBOL_BITS]; // row r of L: bit mask over columns (bit B-1-c for column c)
+			for (unsigned r=0; r<B; ++r) {
+				const uint32_t diag = (uint32_t)1<<(B-1-r);
+				L[r] = ((uint32_t)oqmc_mix(&ss)&~(diag-1)&~diag)|diag; // columns c < r random, c = r one
+			}
+			uint32_t* const v = s->v+B*j;
+			for (unsigned k=0; k<B; ++k) {
+				uint32_t w = 0;
+				for (unsigned r=0; r<B; ++r) {
+					if (__builtin_parity(L[r]&v[k])) w |= (uint32_t)1<<(B-1-r);
+				}
+				v[k] = w;
+			}
+			s->shift[j] = (uint32_t)oqmc_mix(&ss);
+		}
+	}
+	for (size_t j=0; j<D; ++j) s->x[j] = s->shift[j];
+	return 0;
+}
+
+// Position so that the next point returned has index n (Gray-code point n: XOR of the direction numbers
+// for the set bits of n^(n>>1))
+
+static inline void osobol_skip(osobol_t* const s, const uint64_t n)
+{
+	const unsigned B = OSOBOL_BITS;
+	const uint64_t g = n^(n>>1);
+	for (size_t j=0; j<s->D; ++j) {
+		uint32_t x = s->shift[j];
+		for (unsigned k=0; k<B; ++k) if ((g>>k)&1) x ^= s->v[B*j+k];
+		s->x[j] = x;
+	}
+	s->n = n;
+}
+
+// Next point u[0 .. D-1] in (0,1) (cell midpoints, so never 0 or 1), in Gray-code order (at most 2^32-1
+// points)
+
+static inline void osobol_next(osobol_t* const s, double* const u)
+{
+	const unsigned B = OSOBOL_BITS;
+	const size_t D = s->D;
+	for (size_t j=0; j<D; ++j) u[j] = ((double)s->x[j]+0.5)*(1.0/4294967296.0);
+	const unsigned c = (unsigned)__builtin_ctzll(~s->n); // lowest zero bit of n
+	for (size_t j=0; j<D; ++j) s->x[j] ^= s->v[B*j+c];
+	++s->n;
+}
+
+// Inverse standard normal CDF: rational approximation (Abramowitz & Stegun 26.2.23, error < 4.5e-4)
+// refined by two Halley steps on erfc (full double precision)
+
+static inline double oqmc_invnorm(const double p)
+{
+	const double q = p < 0.5 ? p : 1.0-p; // lower tail (no cancellation)
+	const double t = sqrt(-2.0*log(q));
+	double x = (2.515517+t*(0.802853+t*0.010328))/(1.0+t*(1.432788+t*(0.189269+t*0.001308)))-t;
+	for (int it=0; it<2; ++it) {
+		const double e = 0.5*erfc(-x/M_SQRT2)-q;
+		const double w = e*sqrt(2.0*M_PI)*exp(0.5*x*x);
+		x -= w/(1.0+0.5*x*w);
+	}
+	return p < 0.5 ? x : -x;
+}
+
+// Next point as standard normal variates z[0 .. D-1]
+
+static inline void osobol_normal(osobol_t* const s, double* const z)
+{
+	osobol_next(s,z);
+	for (size_t j=0; j<s->D; ++j) z[j] = oqmc_invnorm(z[j]);
+}
+
+// Brownian bridge construction over n equal steps of size h: W at step index 0 .. n (W_0 = 0) from n
+// normal variates, W_n first, then midpoints in breadth-first order
+
+typedef struct {
+	size_t  n;   // number of steps
+	size_t* idx; // point constructed by variate k (n)
+	size_t* lft; // left neighbour (n)
+	size_t* rgt; // right neighbour (n)
+	double* wl;  // left weight (n)
+	double* wr;  // right weight (n)
+	double* sd;  // conditional standard deviation (n)
+	double* W;   // path (n+1, scratch)
+} obb_t;
+
+static inline void obb_free(obb_t* const b)
+{
+	free(b->idx);
+	free(b->wl);
+	b->idx = b->lft = b->rgt = NULL;
+	b->wl = b->wr = b->sd = b->W = NULL;
+}
+
+static inline int obb_init(obb_t* const b, const size_t n, const double h)
+{
+	b->n   = n;
+	b->idx = malloc((3*n+4*n+2)*sizeof(size_t)); // index arrays, and interval queue (2n-1 intervals)
+	b->wl  = malloc((4*n+1)*sizeof(double));
+	if (b->idx == NULL || b->wl == NULL) {
+		obb_free(b);
+		return -1;
+	}
+	b->lft = b->idx+n;
+	b->rgt = b->lft+n;
+	b->wr  = b->wl+n;
+	b->sd  = b->wr+n;
+	b->W   = b->sd+n;
+	size_t* const Q = b->rgt+n; // queue of intervals (l,r)
+	b->idx[0] = n;
+	b->lft[0] = 0;
+	b->rgt[0] = 0;
+	b->wl[0]  = 0.0;
+	b->wr[0]  = 0.0;
+	b->sd[0]  = sqrt((double)n*h);
+	size_t qh = 0, qt = 0, k = 1;
+	Q[qt++] = 0;
+	Q[qt++] = n;
+	while (qh < qt) {
+		const size_t l = Q[qh++], r = Q[qh++];
+		if (r-l < 2) continue;
+		const size_t m = l+(r-l)/2;
+		b->idx[k] = m;
+		b->lft[k] = l;
+		b->rgt[k] = r;
+		b->wl[k]  = (double)(r-m)/(double)(r-l);
+		b->wr[k]  = (double)(m-l)/(double)(r-l);
+		b->sd[k]  = sqrt((double)(m-l)*(double)(r-m)*h/(double)(r-l));
+		++k;
+		Q[qt++] = l;
+		Q[qt++] = m;
+		Q[qt++] = m;
+		Q[qt++] = r;
+	}
+	return 0;
+}
+
+// Wiener increments for an N-variable path of n steps: rows x[N*j .. N*j+N-1] (j = 0 .. n-1) are set to
+// s times the increments over step j; variate k of variable i is z[N*k+i] (so that the coarsest bridge
+// levels of all variables take the leading coordinates)
+
+static inline void obb_noise(obb_t* const b, const size_t N, const double* const z, double* const x, const double s)
+{
+	const size_t n = b->n;
+	double* const W = b->W;
+	for (size_t i=0; i<N; ++i) {
+		W[0] = 0.0;
+		for (size_t k=0; k<n; ++k) W[b->idx[k]] = b->wl[k]*W[b->lft[k]]+b->wr[k]*W[b->rgt[k]]+b->sd[k]*z[N*k+i];
+		for (size_t j=0; j<n; ++j) x[N*j+i] = s*(W[j+1]-W[j]);
+	}
+}
+
+#endif // ODEQMC_H
@@ -0,0 +1,246 @@
+#ifndef ODEREAD_H
+#define ODEREAD_H
+
+// Random-access trajectory file reader (trajectory file format: see odetrj.h)
+//
+// The file is memory-mapped, so only the pages actually accessed are read from disk. For raw value
+// types (OTRJ_DOUBLE), views of time ranges, strided decimations and variable subsets are zero-copy:
+// a view just records a base pointer and strides into the mapping. Compressed files (OTRJ_XORPRED, see
+// odecomp.h) are indexed by block on opening; otrj_copy then decodes only the blocks a view overlaps.
+// Files of 16-bit value types (OTRJ_FLOAT16/OTRJ_BFLOAT16, see odehalf.h) are converted to double by
+// otrj_copy.
+//
+// Functions returning int return 0 on success, or -1 on failure (errno is set where applicable).
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "odetrj.h"
+#include "odecomp.h"
+#include "odehalf.h"
+
+typedef struct {
+	void*            map;    // file mapping
+	size_t           maplen; // mapping length (file size)
+	otrj_hdr_t       hdr;    // file header
+	size_t           N;      // number of variables
+	size_t           n;      // number of rows
+	const double*    data;   // rows (raw value types only)
+	const uint16_t*  half;   // rows (16-bit value types only)
+	size_t           nblk;   // number of blocks (compressed value types only)
+	size_t*          blkrow; // first row of each block, plus total rows (nblk+1)
+	const uint64_t** blk;    // block payloads
+} otrj_map_t;
+
+// Map and index a trajectory file. If the row count in the header is zero (file not closed properly),
+// it is recovered from the file size or block index.
+
+static inline int otrj_map(otrj_map_t* const m, const char* const path)
+{
+	memset(m,0,sizeof(otrj_map_t));
+	const int fd = open(path,O_RDONLY);
+	if (fd < 0) return -1;
+	struct stat st;
+	if (fstat(fd,&st) != 0) {
+		close(fd);
+		return -1;
+	}
+	m->maplen = (size_t)st.st_size;
+	if (m->maplen < sizeof(otrj_hdr_t)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	m->map = mmap(NULL,m->maplen,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if (m->map == MAP_FAILED) {
+		m->map = NULL;
+		return -1;
+	}
+	memcpy(&m->hdr,m->map,sizeof(otrj_hdr_t));
+	m->N = m->hdr.N;
+	m->n = m->hdr.n;
+	const uint8_t* const body = (const uint8_t*)m->map+sizeof(otrj_hdr_t);
+	const size_t blen = m->maplen-sizeof(otrj_hdr_t);
+	if (memcmp(m->hdr.magic,OTRJ_MAGIC,sizeof(OTRJ_MAGIC)) != 0 || m->N == 0) goto invalid;
+	switch (m->hdr.type) {
+		case OTRJ_DOUBLE: {
+			const size_t nmax = blen/(m->N*sizeof(double));
+			if (m->n == 0 || m->n > nmax) m->n = nmax;
+			m->data = (const double*)body;
+			}
+			break;
+		case OTRJ_FLOAT16:
+		case OTRJ_BFLOAT16: {
+			const size_t nmax = blen/(m->N*sizeof(uint16_t));
+			if (m->n == 0 || m->n > nmax) m->n = nmax;
+			m->half = (const uint16_t*)body;
+			}
+			break;
+		case OTRJ_XORPRED: { // index blocks: (rows, words) header, then payload
+			size_t cap = 0, off = 0, rows = 0;
+			while (off+2*sizeof(uint64_t) <= blen) {
+				uint64_t bh[2];
+				memcpy(bh,body+off,sizeof(bh));
+				if (bh[1] > (blen-off)/sizeof(uint64_t)-2) break; // truncated block
+				if (m->nblk+1 >= cap) {
+					cap = 2*cap+16;
+					size_t* const br = realloc(m->blkrow,cap*sizeof(size_t));
+					const uint64_t** const bp = realloc(m->blk,cap*sizeof(uint64_t*));
+					if (br) m->blkrow = br;
+					if (bp) m->blk    = bp;
+					if (br == NULL || bp == NULL) goto fail;
+				}
+				m->blkrow[m->nblk] = rows;
+				m->blk[m->nblk++]  = (const uint64_t*)(body+off)+2;
+				rows += bh[0];
+				off  += (2+bh[1])*sizeof(uint64_t);
+			}
+			if (m->blkrow == NULL && (m->blkrow = malloc(sizeof(size_t))) == NULL) goto fail;
+			m->blkrow[m->nblk] = rows;
+			if (m->n == 0 || m->n > rows) m->n = rows;
+			}
+			break;
+		default:
+			goto invalid;
+	}
+	return 0;
+invalid:
+	errno = EINVAL;
+fail:
+	{
+		const int e = errno;
+		munmap(m->map,m->maplen);
+		free(m->blkrow);
+		free(m->blk);
+		memset(m,0,sizeof(otrj_map_t));
+		errno = e;
+	}
+	return -1;
+}
+
+static inline void otrj_unmap(otrj_map_t* const m)
+{
+	if (m->map != NULL) munmap(m->map,m->maplen);
+	free(m->blkrow);
+	free(m->blk);
+	memset(m,0,sizeof(otrj_map_t));
+}
+
+// Row index for time t (nearest row, clamped to [0,n])
+
+static inline size_t otrj_row(const otrj_map_t* const m, const double t)
+{
+	const double k = (t-m->hdr.t0)/m->hdr.h+0.5;
+	return k <= 0.0 ? 0 : k >= (double)m->n ? m->n : (size_t)k;
+}
+
+// View of rows k0, k0+stride, ... (< k1), of variables vars[0 .. nvars-1] (NULL for variables
+// 0 .. nvars-1). Element (r,c) of a view of a raw file is base[rs*r+cs(c)], where cs(c) = c for
+// contiguous variables, else vars[c].
+
+typedef struct {
+	const otrj_map_t* m;      // mapped file
+	const double*     base;   // first element (raw files; NULL for compressed files)
+	size_t            k0;     // first row
+	size_t            rows;   // number of rows
+	size_t            rs;     // row stride (elements)
+	size_t            stride; // row stride (rows)
+	size_t            cols;   // number of variables
+	const size_t*     vars;   // variable indices (NULL for contiguous variables from v0)
+	size_t            v0;     // first variable (contiguous case)
+} otrj_view_t;
+
+static inline int otrj_slice(otrj_view_t* const v, const otrj_map_t* const m, const size_t k0, const size_t k1, const size_t stride, const size_t v0, const size_t* const vars, const size_t nvars)
+{
+	if (k0 > k1 || k1 > m->n || stride == 0 || nvars == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	for (size_t c=0; c<nvars; ++c) {
+		if ((vars ? vars[c] : v0+c) >= m->N) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+	v->m      = m;
+	v->k0     = k0;
+	v->rows   = (k1-k0+stride-1)/stride;
+	v->stride = stride;
+	v->rs     = stride*m->N;
+	v->cols   = nvars;
+	v->vars   = vars;
+	v->v0     = v0;
+	v->base   = m->data ? m->data+m->N*k0+(vars ? 0 : v0) : NULL;
+	return 0;
+}
+
+// Element (r,c) of a view of a raw file (zero-copy)
+
+static inline double otrj_at(const otrj_view_t* const v, const size_t r, const size_t c)
+{
+	return v->base[v->rs*r+(v->vars ? v->vars[c] : c)];
+}
+
+// Hint that a view is about to be read (pre-fault its pages, raw files only)
+
+static inline void otrj_willneed(const otrj_view_t* const v)
+{
+	if (v->base == NULL || v->rows == 0) return;
+	const long pg = sysconf(_SC_PAGESIZE);
+	const uintptr_t a = (uintptr_t)v->base & ~(uintptr_t)(pg-1);
+	const uintptr_t e = (uintptr_t)(v->base+v->rs*(v->rows-1)+v->m->N);
+	madvise((void*)a,e-a,MADV_WILLNEED);
+}
+
+// Copy a view to out (rows x cols, row-major). For compressed files only the blocks overlapping the
+// view are decoded.
+
+static inline int otrj_copy(const otrj_view_t* const v, double* const out)
+{
+	const otrj_map_t* const m = v->m;
+	const size_t N = m->N, cols = v->cols;
+	if (v->base != NULL) {
+		for (size_t r=0; r<v->rows; ++r) {
+			for (size_t c=0; c<cols; ++c) out[cols*r+c] = otrj_at(v,r,c);
+		}
+		return 0;
+	}
+	if (v->rows == 0) return 0;
+	if (m->half != NULL) {
+		const otrj_type_t type = (otrj_type_t)m->hdr.type;
+		double* const x = malloc(N*sizeof(double));
+		if (x == NULL) return -1;
+		for (size_t r=0; r<v->rows; ++r) {
+			ohalf_unpack(x,m->half+N*(v->k0+v->stride*r),N,type);
+			for (size_t c=0; c<cols; ++c) out[cols*r+c] = x[v->vars ? v->vars[c] : v->v0+c];
+		}
+		free(x);
+		return 0;
+	}
+	size_t bmax = 0;
+	for (size_t b=0; b<m->nblk; ++b) if (m->blkrow[b+1]-m->blkrow[b] > bmax) bmax = m->blkrow[b+1]-m->blkrow[b];
+	double* const buf = malloc(bmax*N*sizeof(double));
+	if (buf == NULL) return -1;
+	size_t b = 0, r = 0, k = v->k0;
+	const size_t klast = v->k0+v->stride*(v->rows-1);
+	while (k <= klast) {
+		while (m->blkrow[b+1] <= k) ++b; // block containing row k
+		const size_t kb = m->blkrow[b], nb = m->blkrow[b+1]-kb;
+		ocomp_decode(m->blk[b],nb,N,buf);
+		for (; k < kb+nb && k <= klast; k += v->stride, ++r) {
+			const double* const x = buf+N*(k-kb);
+			for (size_t c=0; c<cols; ++c) out[cols*r+c] = x[v->vars ? v->vars[c] : v->v0+c];
+		}
+	}
+	free(buf);
+	return 0;
+}
+
+#endif // ODEREAD_H
@@ -0,0 +1,246 @@
+#ifndef ODESPEC_H
+#define ODESPEC_H
+
+// Streaming spectral estimation: Welch power spectral density (PSD) estimator, fed one state at a
+// time from the integration loop (see ODESTEP in ode.h), and the in-house mixed-radix FFT it uses.
+//
+// The estimator holds only the current window of L states (a ring buffer), so memory is O(L*N)
+// regardless of run length. Segments are (constant-)detrended and Hann-windowed; per-variable
+// periodograms are accumulated, two real variables per complex FFT.
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+// Mixed-radix (recursive Cooley-Tukey, decimation in time) complex FFT, any length L. Radix 2 and 4
+// butterflies are specialised; other prime factors p use a generic O(p^2) butterfly, so lengths
+// should have small prime factors for efficiency.
+
+#define OFFT_MAXFAC 64
+
+typedef struct {
+	size_t          L;                  // transform length
+	size_t          fac[2*OFFT_MAXFAC]; // factorisation: (radix, remaining length) pairs
+	double complex* tw;                 // twiddle factors exp(-2 pi i k/L), k = 0 .. L-1
+} offt_t;
+
+static inline int offt_init(offt_t* const f, const size_t L)
+{
+	f->L  = L;
+	f->tw = malloc(L*sizeof(double complex));
+	if (f->tw == NULL) return -1;
+	const double a = -2.0*M_PI/(double)L;
+	for (size_t k=0; k<L; ++k) f->tw[k] = cexp(I*(a*(double)k));
+	size_t m = L, j = 0;
+	while (m > 1) {
+		size_t p = m%4 == 0 ? 4 : m%2 == 0 ? 2 : 3;
+		while (m%p != 0) p += 2; // next odd candidate; terminates at m if prime
+		m /= p;
+		f->fac[j++] = p;
+		f->fac[j++] = m;
+	}
+	if (j == 0) { // L = 1
+		f->fac[j++] = 1;
+		f->fac[j++] = 1;
+	}
+	return 0;
+}
+
+static inline void offt_free(offt_t* const f)
+{
+	free(f->tw);
+	f->tw = NULL;
+}
+
+static inline void offt_rec(const offt_t* const f, double complex* const out, const double complex* const in, const size_t s, const size_t* const fac)
+{
+	const size_t p = fac[0]; // radix
+	const size_t m = fac[1]; // length of sub-transforms
+	if (m == 1) {
+		for (size_t q=0; q<p; ++q) out[q] = in[q*s];
+	}
+	else {
+		for (size_t q=0; q<p; ++q) offt_rec(f,out+q*m,in+q*s,s*p,fac+2);
+	}
+	const double complex* const tw = f->tw;
+	switch (p) {
+		case 1:
+			break;
+		case 2:
+			for (size_t k=0; k<m; ++k) {
+				const double complex t0 = out[k];
+				const double complex t1 = out[k+m]*tw[k*s];
+				out[k]   = t0+t1;
+				out[k+m] = t0-t1;
+			}
+			break;
+		case 4:
+			for (size_t k=0; k<m; ++k) {
+				const double complex t0 = out[k];
+				const double complex t1 = out[k+m]*tw[k*s];
+				const double complex t2 = out[k+2*m]*tw[2*k*s];
+				const double complex t3 = out[k+3*m]*tw[3*k*s];
+				const double complex a0 = t0+t2, a1 = t0-t2;
+				const double complex d  = t1-t3;
+				const double complex b0 = t1+t3, b1 = CMPLX(cimag(d),-creal(d)); // -i*(t1-t3)
+				out[k]     = a0+b0;
+				out[k+m]   = a1+b1;
+				out[k+2*m] = a0-b0;
+				out[k+3*m] = a1-b1;
+			}
+			break;
+		default: {
+			const size_t L = f->L;
+			double complex t[p];
+			for (size_t k=0; k<m; ++k) {
+				for (size_t q=0; q<p; ++q) t[q] = out[k+q*m]*tw[q*k*s];
+				for (size_t r=0; r<p; ++r) {
+					double complex y = t[0];
+					for (size_t q=1; q<p; ++q) y += t[q]*tw[(q*r*m*s)%L];
+					out[k+r*m] = y;
+				}
+			}}
+			break;
+	}
+}
+
+// Forward transform (unnormalised) of in to out; in and out must not overlap
+
+static inline void offt(const offt_t* const f, double complex* const out, const double complex* const in)
+{
+	offt_rec(f,out,in,1,f->fac);
+}
+
+// Welch PSD estimator
+
+typedef struct {
+	size_t          N;     // number of variables
+	size_t          L;     // window (segment) length
+	size_t          hop;   // samples between segment starts (L minus overlap)
+	size_t          nf;    // number of (one-sided) frequencies, L/2+1
+	double          fs;    // sampling frequency (1/h)
+	size_t          pos;   // next ring buffer slot
+	size_t          nfill; // number of samples in ring buffer
+	size_t          since; // samples since last segment
+	size_t          nseg;  // number of segments accumulated
+	double          wss;   // sum of squared window values
+	double*         win;   // window (length L)
+	double*         buf;   // ring buffer of states (L x N, row-major)
+	double*         pxx;   // accumulated periodograms (N x nf, row-major)
+	double*         mu;    // segment means (workspace)
+	double complex* z;     // FFT input  (workspace)
+	double complex* Z;     // FFT output (workspace)
+	offt_t          fft;
+} owelch_t;
+
+// Window length L, overlap noverlap (< L) samples, integration step size h
+
+static inline int owelch_init(owelch_t* const w, const size_t N, const size_t L, const size_t noverlap, const double h)
+{
+	memset(w,0,sizeof(owelch_t));
+	w->N   = N;
+	w->L   = L;
+	w->hop = L-noverlap;
+	w->nf  = L/2+1;
+	w->fs  = 1.0/h;
+	w->win = malloc((L+L*N+N*w->nf+N)*sizeof(double));
+	w->z   = malloc(2*L*sizeof(double complex));
+	if (w->win == NULL || w->z == NULL || offt_init(&w->fft,L) != 0) {
+		free(w->win);
+		free(w->z);
+		return -1;
+	}
+	w->buf = w->win+L;
+	w->pxx = w->buf+L*N;
+	w->mu  = w->pxx+N*w->nf;
+	w->Z   = w->z+L;
+	memset(w->pxx,0,N*w->nf*sizeof(double));
+	const double a = 2.0*M_PI/(double)L;
+	for (size_t t=0; t<L; ++t) { // periodic Hann window
+		w->win[t] = 0.5-0.5*cos(a*(double)t);
+		w->wss += w->win[t]*w->win[t];
+	}
+	return 0;
+}
+
+static inline void owelch_free(owelch_t* const w)
+{
+	offt_free(&w->fft);
+	free(w->z);
+	free(w->win);
+	w->win = w->buf = w->pxx = w->mu = NULL;
+	w->z = w->Z = NULL;
+}
+
+// Process the current (full) ring buffer as a segment
+
+static inline void owelch_segment(owelch_t* const w)
+{
+	const size_t N = w->N, L = w->L, nf = w->nf;
+	for (size_t i=0; i<N; ++i) w->mu[i] = 0.0;
+	for (size_t t=0; t<L; ++t) for (size_t i=0; i<N; ++i) w->mu[i] += w->buf[N*t+i];
+	for (size_t i=0; i<N; ++i) w->mu[i] /= (double)L;
+	for (size_t i=0; i<N; i+=2) {
+		const int pair = i+1 < N;
+		for (size_t t=0, s=w->pos; t<L; ++t, s = s+1 == L ? 0 : s+1) { // oldest sample first
+			const double* const b = w->buf+N*s+i;
+			const double re = w->win[t]*(b[0]-w->mu[i]);
+			const double im = pair ? w->win[t]*(b[1]-w->mu[i+1]) : 0.0;
+			w->z[t] = CMPLX(re,im);
+		}
+		offt(&w->fft,w->Z,w->z);
+		double* const pa = w->pxx+nf*i;
+		double* const pb = pa+nf;
+		for (size_t k=0; k<nf; ++k) { // separate the transforms of the real and imaginary parts
+			const double complex Zk = w->Z[k];
+			const double complex Zc = conj(w->Z[k == 0 ? 0 : L-k]);
+			const double complex A  = 0.5*(Zk+Zc);
+			pa[k] += creal(A)*creal(A)+cimag(A)*cimag(A);
+			if (pair) {
+				const double complex B = -0.5*I*(Zk-Zc);
+				pb[k] += creal(B)*creal(B)+cimag(B)*cimag(B);
+			}
+		}
+	}
+	++w->nseg;
+}
+
+// Feed the current state x (length N)
+
+static inline void owelch_update(owelch_t* const w, const double* const x)
+{
+	memcpy(w->buf+w->N*w->pos,x,w->N*sizeof(double));
+	w->pos = w->pos+1 == w->L ? 0 : w->pos+1;
+	if (w->nfill < w->L) ++w->nfill;
+	if (++w->since >= w->hop && w->nfill == w->L) {
+		owelch_segment(w);
+		w->since = 0;
+	}
+}
+
+// One-sided PSD estimates (psd has length N*nf, row-major per variable; requires nseg > 0)
+
+static inline void owelch_psd(const owelch_t* const w, double* const psd)
+{
+	const size_t nf = w->nf;
+	const double c = 1.0/(w->fs*w->wss*(double)w->nseg);
+	for (size_t i=0; i<w->N; ++i) {
+		const double* const p = w->pxx+nf*i;
+		double* const q = psd+nf*i;
+		for (size_t k=0; k<nf; ++k) q[k] = 2.0*c*p[k];
+		q[0] = c*p[0];
+		if (w->L%2 == 0) q[nf-1] = c*p[nf-1];
+	}
+}
+
+// Frequency of k-th PSD bin
+
+static inline double owelch_freq(const owelch_t* const w, const size_t k)
+{
+	return (double)k*w->fs/(double)w->L;
+}
+
+#endif // ODESPEC_H
@@ -0,0 +1,258 @@
+#ifndef ODESTATS_H
+#define ODESTATS_H
+
+// Streaming ("on-the-fly") statistics accumulators for ODE/SDE trajectories.
+//
+// Accumulators are updated with the current state at each integration step (see ODESTEP in ode.h),
+// so that the trajectory need never be stored. Accumulators for separate chunks of data (e.g. time
+// segments or ensemble members processed on separate threads, each with its own accumulator) may be
+// merged; the *_reduce functions merge an array of accumulators in a fixed pairwise tree order, so
+// that results do not depend on thread scheduling, and rounding error grows only as O(log m).
+//
+// The *_init functions return 0 on success, or -1 if memory allocation fails (errno is set).
+
+#include <stdlib.h>
+#include <string.h>
+
+// Deterministic pairwise tree reduction of an array a[0 .. m-1] of accumulators into a[0]
+
+#define OSTATS_REDUCE(merge,a,m) \
+{ \
+	for (size_t s_=1; s_<(m); s_ *= 2) { \
+		for (size_t i_=0; i_+s_<(m); i_ += 2*s_) merge(&(a)[i_],&(a)[i_+s_]); \
+	} \
+}
+
+// Mean, variance (Welford's algorithm), minimum and maximum, per variable
+
+typedef struct {
+	size_t  N;    // number of variables
+	size_t  n;    // number of observations
+	double* mean; // running means
+	double* m2;   // running sums of squared deviations from the mean
+	double* min;  // running minima
+	double* max;  // running maxima
+} ostats_t;
+
+static inline int ostats_init(ostats_t* const s, const size_t N)
+{
+	double* const buf = calloc(4*N,sizeof(double));
+	if (buf == NULL) return -1;
+	s->N    = N;
+	s->n    = 0;
+	s->mean = buf;
+	s->m2   = buf+N;
+	s->min  = buf+2*N;
+	s->max  = buf+3*N;
+	return 0;
+}
+
+static inline void ostats_free(ostats_t* const s)
+{
+	free(s->mean);
+	s->mean = s->m2 = s->min = s->max = NULL;
+}
+
+static inline void ostats_update(ostats_t* const s, const double* const x)
+{
+	const size_t N = s->N;
+	if (s->n++ == 0) {
+		for (size_t i=0; i<N; ++i) {
+			s->mean[i] = s->min[i] = s->max[i] = x[i];
+			s->m2[i]   = 0.0;
+		}
+		return;
+	}
+	const double rn = 1.0/(double)s->n;
+	for (size_t i=0; i<N; ++i) {
+		const double d = x[i]-s->mean[i];
+		s->mean[i] += rn*d;
+		s->m2[i]   += d*(x[i]-s->mean[i]);
+		s->min[i]   = x[i] < s->min[i] ? x[i] : s->min[i];
+		s->max[i]   = x[i] > s->max[i] ? x[i] : s->max[i];
+	}
+}
+
+// Merge accumulator b into a (Chan et al. parallel update)
+
+static inline void ostats_merge(ostats_t* const a, const ostats_t* const b)
+{
+	if (b->n == 0) return;
+	const size_t N = a->N;
+	if (a->n == 0) {
+		a->n = b->n;
+		memcpy(a->mean,b->mean,4*N*sizeof(double)); // contiguous
+		return;
+	}
+	const double na = (double)a->n;
+	const double nb = (double)b->n;
+	const double rn = 1.0/(na+nb);
+	for (size_t i=0; i<N; ++i) {
+		const double d = b->mean[i]-a->mean[i];
+		a->mean[i] += nb*rn*d;
+		a->m2[i]   += b->m2[i] + na*nb*rn*d*d;
+		a->min[i]   = b->min[i] < a->min[i] ? b->min[i] : a->min[i];
+		a->max[i]   = b->max[i] > a->max[i] ? b->max[i] : a->max[i];
+	}
+	a->n += b->n;
+}
+
+static inline void ostats_reduce(ostats_t* const a, const size_t m)
+{
+	OSTATS_REDUCE(ostats_merge,a,m);
+}
+
+// Unbiased variance estimates (var must have length N; requires at least two observations)
+
+static inline void ostats_var(const ostats_t* const s, double* const var)
+{
+	const double rn1 = 1.0/(double)(s->n-1);
+	for (size_t i=0; i<s->N; ++i) var[i] = rn1*s->m2[i];
+}
+
+// Means and covariance matrix
+
+typedef struct {
+	size_t  N;    // number of variables
+	size_t  n;    // number of observations
+	double* mean; // running means
+	double* C;    // running co-moments (N x N, row-major; upper triangle only)
+	double* d;    // workspace
+} ocov_t;
+
+static inline int ocov_init(ocov_t* const c, const size_t N)
+{
+	double* const buf = calloc(N*N+2*N,sizeof(double));
+	if (buf == NULL) return -1;
+	c->N    = N;
+	c->n    = 0;
+	c->mean = buf;
+	c->d    = buf+N;
+	c->C    = buf+2*N;
+	return 0;
+}
+
+static inline void ocov_free(ocov_t* const c)
+{
+	free(c->mean);
+	c->mean = c->d = c->C = NULL;
+}
+
+static inline void ocov_update(ocov_t* const c, const double* const x)
+{
+	const size_t N = c->N;
+	const double rn = 1.0/(double)(++c->n);
+	for (size_t i=0; i<N; ++i) {
+		c->d[i]     = x[i]-c->mean[i];  // deviation from old mean
+		c->mean[i] += rn*c->d[i];
+	}
+	for (size_t i=0; i<N; ++i) {
+		const double di = c->d[i];
+		double* const Ci = c->C+N*i;
+		for (size_t j=i; j<N; ++j) Ci[j] += di*(x[j]-c->mean[j]);
+	}
+}
+
+// Merge accumulator b into a
+
+static inline void ocov_merge(ocov_t* const a, const ocov_t* const b)
+{
+	if (b->n == 0) return;
+	const size_t N = a->N;
+	if (a->n == 0) {
+		a->n = b->n;
+		memcpy(a->mean,b->mean,N*sizeof(double));
+		memcpy(a->C,b->C,N*N*sizeof(double));
+		return;
+	}
+	const double na = (double)a->n;
+	const double nb = (double)b->n;
+	const double f  = na*nb/(na+nb);
+	for (size_t i=0; i<N; ++i) a->d[i] = b->mean[i]-a->mean[i];
+	for (size_t i=0; i<N; ++i) {
+		const double di = f*a->d[i];
+		double* const Ci = a->C+N*i;
+		const double* const Bi = b->C+N*i;
+		for (size_t j=i; j<N; ++j) Ci[j] += Bi[j] + di*a->d[j];
+	}
+	const double g = nb/(na+nb);
+	for (size_t i=0; i<N; ++i) a->mean[i] += g*a->d[i];
+	a->n += b->n;
+}
+
+static inline void ocov_reduce(ocov_t* const a, const size_t m)
+{
+	OSTATS_REDUCE(ocov_merge,a,m);
+}
+
+// Unbiased covariance matrix estimate (cov must have length N*N; full symmetric matrix is returned)
+
+static inline void ocov_cov(const ocov_t* const c, double* const cov)
+{
+	const size_t N = c->N;
+	const double rn1 = 1.0/(double)(c->n-1);
+	for (size_t i=0; i<N; ++i) {
+		for (size_t j=i; j<N; ++j) cov[N*i+j] = cov[N*j+i] = rn1*c->C[N*i+j];
+	}
+}
+
+// Fixed-bin histograms, per variable, over a common range [lo,hi). Values outside the range (and
+// NaNs, which are counted as underflow) are tallied separately.
+
+typedef struct {
+	size_t  N;     // number of variables
+	size_t  nbins; // number of bins
+	double  lo;    // lower bound of range
+	double  hi;    // upper bound of range
+	double  scale; // nbins/(hi-lo)
+	size_t* count; // bin counts (N x nbins, row-major)
+	size_t* under; // underflow counts
+	size_t* over;  // overflow counts
+} ohist_t;
+
+static inline int ohist_init(ohist_t* const g, const size_t N, const size_t nbins, const double lo, const double hi)
+{
+	size_t* const buf = calloc(N*nbins+2*N,sizeof(size_t));
+	if (buf == NULL) return -1;
+	g->N     = N;
+	g->nbins = nbins;
+	g->lo    = lo;
+	g->hi    = hi;
+	g->scale = (double)nbins/(hi-lo);
+	g->count = buf;
+	g->under = buf+N*nbins;
+	g->over  = buf+N*nbins+N;
+	return 0;
+}
+
+static inline void ohist_free(ohist_t* const g)
+{
+	free(g->count);
+	g->count = g->under = g->over = NULL;
+}
+
+static inline void ohist_update(ohist_t* const g, const double* const x)
+{
+	const double fbins = (double)g->nbins;
+	for (size_t i=0; i<g->N; ++i) {
+		const double z = g->scale*(x[i]-g->lo);
+		if      (!(z >= 0.0)) ++g->under[i];
+		else if (z >= fbins)  ++g->over[i];
+		else                  ++g->count[g->nbins*i+(size_t)z];
+	}
+}
+
+// Merge histogram b into a (ranges and bin numbers must match)
+
+static inline void ohist_merge(ohist_t* const a, const ohist_t* const b)
+{
+	const size_t m = a->N*a->nbins+2*a->N;
+	for (size_t k=0; k<m; ++k) a->count[k] += b->count[k]; // contiguous
+}
+
+static inline void ohist_reduce(ohist_t* const a, const size_t m)
+{
+	OSTATS_REDUCE(ohist_merge,a,m);
+}
+
+#endif // ODESTATS_H
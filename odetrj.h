@@ -0,0 +1,93 @@
+#ifndef ODETRJ_H
+#define ODETRJ_H
+
+// Binary trajectory file format
+//
+// A 64-byte header, followed by n rows (time steps) of N values each, in native byte order:
+//
+// Field    Description                          Type
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+// magic    "ODETRJ1" (NUL-terminated)           char[8]
+// N        number of variables                  uint64_t
+// n        number of rows (time steps)          uint64_t
+// h        time increment between rows          double
+// t0       time of first row                    double
+// type     value type (see otrj_type_t)         uint32_t
+// size     bytes per value                      uint32_t
+// (pad)    zero                                 uint8_t[16]
+// ————————————————————————————————————————————————————————————————————————————————————————————————
+//
+// The header size keeps the data suitably aligned for memory-mapped access. The row count is written
+// when the file is closed, so a file truncated by a crash has n = 0.
+//
+// For compressed value types (size = 0) the data consists of independently decodable blocks instead
+// of raw rows; see odecomp.h. The 16-bit value types (IEEE half precision, bfloat16) are for storage
+// only, e.g. of visualisation runs; see odehalf.h.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OTRJ_MAGIC "ODETRJ1"
+
+typedef enum {OTRJ_DOUBLE = 0, OTRJ_XORPRED, OTRJ_FLOAT16, OTRJ_BFLOAT16, OTRJ_UNKNOWN} otrj_type_t;
+
+typedef struct {
+	char     magic[8];
+	uint64_t N;
+	uint64_t n;
+	double   h;
+	double   t0;
+	uint32_t type;
+	uint32_t size;
+	uint8_t  pad[16];
+} otrj_hdr_t;
+
+_Static_assert(sizeof(otrj_hdr_t) == 64,"trajectory file header must be 64 bytes");
+
+static inline size_t otrj_size(const otrj_type_t type)
+{
+	switch (type) {
+		case OTRJ_DOUBLE:   return sizeof(double);
+		case OTRJ_XORPRED:  return 0; // compressed
+		case OTRJ_FLOAT16:
+		case OTRJ_BFLOAT16: return sizeof(uint16_t);
+		default:            return 0;
+	}
+}
+
+// Open a trajectory file for writing and write the header; returns NULL on failure (errno is set)
+
+static inline FILE* otrj_open(const char* const path, const size_t N, const double h, const double t0, const otrj_type_t type)
+{
+	FILE* const fs = fopen(path,"wb");
+	if (fs == NULL) return NULL;
+	otrj_hdr_t hdr;
+	memset(&hdr,0,sizeof(hdr));
+	memcpy(hdr.magic,OTRJ_MAGIC,sizeof(OTRJ_MAGIC));
+	hdr.N    = N;
+	hdr.h    = h;
+	hdr.t0   = t0;
+	hdr.type = (uint32_t)type;
+	hdr.size = (uint32_t)otrj_size(type);
+	if (fwrite(&hdr,sizeof(hdr),1,fs) != 1) {
+		fclose(fs);
+		return NULL;
+	}
+	return fs;
+}
+
+// Write the row count into the header and close the file; returns 0 on success, -1 on failure
+
+static inline int otrj_close(FILE* const fs, const size_t n)
+{
+	const uint64_t n64 = n;
+	if (fseek(fs,(long)offsetof(otrj_hdr_t,n),SEEK_SET) != 0 || fwrite(&n64,sizeof(n64),1,fs) != 1) {
+		fclose(fs);
+		return -1;
+	}
+	return fclose(fs) == 0 ? 0 : -1;
+}
+
+#endif // ODETRJ_H
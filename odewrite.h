@@ -0,0 +1,200 @@
+#ifndef ODEWRITE_H
+#define ODEWRITE_H
+
+// Asynchronous (multi-buffered) trajectory writer
+//
+// The integration loop (see ODESTEP in ode.h) writes states into the current buffer of B rows; full
+// buffers are handed to a writer thread through a lock-free single-producer/single-consumer queue of
+// nbuf buffers (nbuf = 2 for double buffering), so that file output overlaps with integration. The
+// integration thread only waits if the writer falls nbuf-1 buffers behind (counted in 'stalls').
+//
+// Buffers are written by a block function
+//
+//   	int blkfun(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+//
+// returning 0 on success; ow_binary (raw values, e.g. for trajectory files, see odetrj.h) and ow_ascii
+// (" %16.8f" per value, one row per line, formatted with odefmt.h) are supplied.
+//
+// Requires POSIX threads (compile and link with -pthread).
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "odefmt.h"
+
+typedef int (*owblk_t)(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg);
+
+typedef struct {
+	FILE*         fs;     // output stream (opened and closed by the caller)
+	size_t        N;      // number of variables (values per row)
+	size_t        B;      // rows per buffer
+	size_t        nbuf;   // number of buffers
+	double*       buf;    // buffers (nbuf x B x N)
+	size_t*       rows;   // number of rows in each buffer
+	size_t        fill;   // rows in current (producer) buffer
+	size_t        nrows;  // total rows written
+	size_t        stalls; // number of times the producer waited for a free buffer
+	owblk_t       blkfun; // block function
+	void*         arg;    // block function argument
+	atomic_size_t head;   // buffers published by producer
+	atomic_size_t tail;   // buffers consumed by writer thread
+	atomic_int    done;   // producer finished
+	atomic_int    err;    // block function failed (errno value, or -1)
+	pthread_t     thread;
+} owriter_t;
+
+// Block functions
+
+static inline int ow_binary(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+{
+	(void)arg;
+	return fwrite(blk,sizeof(double),rows*N,fs) == rows*N ? 0 : -1;
+}
+
+static inline int ow_ascii(FILE* const fs, const double* const blk, const size_t rows, const size_t N, void* const arg)
+{
+	(void)arg;
+	const size_t rmax = N*(1+OFMT_MAX(16,8))+1;
+	const size_t bsiz = rmax > 65536 ? 2*rmax : 65536;
+	char* const buf = malloc(bsiz);
+	if (buf == NULL) return -1;
+	const int ret = ofmt_write(fs,blk,rows,N,16,8,1,buf,bsiz);
+	free(buf);
+	return ret;
+}
+
+// Wait politely: spin briefly, then yield, then sleep
+
+static inline void ow_backoff(unsigned* const spins)
+{
+	if (*spins < 16) {
+		++*spins;
+	}
+	else if (*spins < 64) {
+		++*spins;
+		sched_yield();
+	}
+	else {
+		const struct timespec ts = {0,50000}; // 50us
+		nanosleep(&ts,NULL);
+	}
+}
+
+static inline void* ow_thread(void* const p)
+{
+	owriter_t* const w = p;
+	size_t tail = atomic_load_explicit(&w->tail,memory_order_relaxed);
+	unsigned spins = 0;
+	for (;;) {
+		const int    done = atomic_load_explicit(&w->done,memory_order_acquire);
+		const size_t head = atomic_load_explicit(&w->head,memory_order_acquire);
+		if (tail == head) {
+			if (done) break;
+			ow_backoff(&spins);
+			continue;
+		}
+		spins = 0;
+		const size_t s = tail%w->nbuf;
+		if (atomic_load_explicit(&w->err,memory_order_relaxed) == 0) {
+			errno = 0;
+			if (w->blkfun(w->fs,w->buf+w->B*w->N*s,w->rows[s],w->N,w->arg) != 0) {
+				atomic_store_explicit(&w->err,errno ? errno : -1,memory_order_relaxed);
+			}
+		}
+		atomic_store_explicit(&w->tail,++tail,memory_order_release);
+	}
+	return NULL;
+}
+
+// Start a writer on stream fs with nbuf (at least 2) buffers of B rows; returns 0 on success, -1 on
+// failure (errno is set)
+
+static inline int ow_open(owriter_t* const w, FILE* const fs, const size_t N, const size_t B, const size_t nbuf, const owblk_t blkfun, void* const arg)
+{
+	w->fs     = fs;
+	w->N      = N;
+	w->B      = B;
+	w->nbuf   = nbuf;
+	w->fill   = 0;
+	w->nrows  = 0;
+	w->stalls = 0;
+	w->blkfun = blkfun;
+	w->arg    = arg;
+	atomic_init(&w->head,0);
+	atomic_init(&w->tail,0);
+	atomic_init(&w->done,0);
+	atomic_init(&w->err,0);
+	w->buf  = malloc(nbuf*B*N*sizeof(double));
+	w->rows = malloc(nbuf*sizeof(size_t));
+	if (w->buf == NULL || w->rows == NULL) {
+		free(w->buf);
+		free(w->rows);
+		return -1;
+	}
+	const int rc = pthread_create(&w->thread,NULL,ow_thread,w);
+	if (rc != 0) {
+		free(w->buf);
+		free(w->rows);
+		errno = rc;
+		return -1;
+	}
+	return 0;
+}
+
+// Publish the current buffer to the writer thread, and wait for the next buffer to become free
+
+static inline void ow_publish(owriter_t* const w)
+{
+	const size_t head = atomic_load_explicit(&w->head,memory_order_relaxed);
+	w->rows[head%w->nbuf] = w->fill;
+	atomic_store_explicit(&w->head,head+1,memory_order_release);
+	w->fill = 0;
+	if (head+1-atomic_load_explicit(&w->tail,memory_order_acquire) < w->nbuf) return;
+	++w->stalls;
+	unsigned spins = 0;
+	while (head+1-atomic_load_explicit(&w->tail,memory_order_acquire) >= w->nbuf) ow_backoff(&spins);
+}
+
+// Pointer to the next row, to be filled in by the caller before the next call to ow_next, ow_push
+// or ow_close (so the integration may write directly into the buffer)
+
+static inline double* ow_next(owriter_t* const w)
+{
+	if (w->fill == w->B) ow_publish(w);
+	const size_t s = atomic_load_explicit(&w->head,memory_order_relaxed)%w->nbuf;
+	++w->nrows;
+	return w->buf+w->N*(w->B*s+w->fill++);
+}
+
+// Copy state x (length N) to the next row
+
+static inline void ow_push(owriter_t* const w, const double* const x)
+{
+	double* const r = ow_next(w);
+	for (size_t i=0; i<w->N; ++i) r[i] = x[i];
+}
+
+// Flush remaining rows, stop the writer thread and free buffers (the stream is not closed); returns 0
+// on success, or -1 if any block failed to write (errno is set)
+
+static inline int ow_close(owriter_t* const w)
+{
+	if (w->fill > 0) ow_publish(w);
+	atomic_store_explicit(&w->done,1,memory_order_release);
+	pthread_join(w->thread,NULL);
+	free(w->buf);
+	free(w->rows);
+	w->buf  = NULL;
+	w->rows = NULL;
+	const int err = atomic_load(&w->err);
+	if (err == 0) return 0;
+	if (err > 0) errno = err;
+	return -1;
+}
+
+#endif // ODEWRITE_H
@@ -7,8 +7,31 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 
 #include "ode.h"
+#include "odestats.h"
+#include "odespec.h"
+#include "odecorr.h"
+#include "odetrj.h"
+#include "odewrite.h"
+#include "odecomp.h"
+#include "odefmt.h"
+#include "oderead.h"
+#include "odeplot.h"
+#include "odepyr.h"
+#include "odehalf.h"
+#include "odeforce.h"
+#include "odedde.h"
+#include "odelif.h"
+#include "odenet.h"
+#include "odekur.h"
+#include "odenoise.h"
+#include "odejump.h"
+#include "odemc.h"
+#include "odeqmc.h"
+#include "odebtree.h"
+#include "odeens.h"
 #include "mt64.h"
 
 // The "Lorenz 96" chaotic system (https://en.wikipedia.org/wiki/Lorenz_96_model)
@@ -35,6 +58,8 @@ int lorenz96test(int argc, char* argv[])
 	const char* const of  = argc > 6 ?              argv[6]    : "/tmp/lorenz96.asc";
 #ifdef HAVE_GNUPLOT
 	const char* const gf  = argc > 7 ?              argv[7]    : "/tmp/lorenz96.gp";
+	const char* const pf  = argc > 8 ?              argv[8]    : "/tmp/lorenz96.bin"; // downsampled plot data
+	const int         lp  = argc > 9 ?         atoi(argv[9])   : 0;      // live plotting during integration?
 #endif //HAVE_GNUPLOT
 
 	// Display command-line  parameters
@@ -59,40 +84,106 @@ int lorenz96test(int argc, char* argv[])
 		return EXIT_FAILURE;
 	}
 
-	// Allocate memory for variables
+	// Open output file: binary trajectory file (see odetrj.h) if the file name ends in ".trj", else ASCII
 
-	double* const x = calloc(N*n,sizeof(double));
+	const size_t oflen = strlen(of);
+	const int binary = oflen > 4 && strcmp(of+oflen-4,".trj") == 0;
+	FILE* const offs = binary ? otrj_open(of,N,dt,0.0,OTRJ_DOUBLE) : fopen(of,"w");
+	if (offs == NULL) {
+		perror("ERROR: Failed to open output file");
+		return EXIT_FAILURE;
+	}
 
-	// Set some initial values (here we need at least one variable not to be zero)
+	// For binary output, the writer also builds a min/max/mean pyramid (16x decimation per level) in
+	// "<output file>.pyr", for zoomable viewing (see odepyr.h)
 
-	x[0] = 1.0;
+	opyr_t pyr;
+	char pyrf[oflen+5];
+	snprintf(pyrf,sizeof(pyrf),"%s.pyr",of);
+	if (binary && opyr_open(&pyr,pyrf,N,n,16,dt,0.0) != 0) {
+		perror("ERROR: Failed to open pyramid file");
+		return EXIT_FAILURE;
+	}
 
-	// Solve the ODE
+	// Start asynchronous writer (integration proceeds while full buffers are written on another thread)
 
-	ODE(solver,lorenz96,x,N,n,dt,N,F);
+	owriter_t w;
+	if (ow_open(&w,offs,N,4096,2,binary ? ow_binary_pyr : ow_ascii,binary ? &pyr : NULL) != 0) {
+		perror("ERROR: Failed to start output writer");
+		return EXIT_FAILURE;
+	}
 
-	// Write results to file
+#ifdef HAVE_GNUPLOT
+	// Decimated phase-plot data (first three variables) in Gnuplot binary format (resolution about
+	// 1/1000 of the attractor extent)
 
-	FILE* const offs = fopen(of,"w");
-	if (offs == NULL) {
-		perror("ERROR: Failed to open output file");
+	FILE* const pfs = fopen(pf,"wb");
+	const size_t pcols[3] = {0,1,2};
+	oplot_t plt;
+	if (pfs == NULL || oplot_open_phase(&plt,pfs,pcols,3,0.02) != 0) {
+		perror("ERROR: Failed to open plot data file");
+		return EXIT_FAILURE;
+	}
+
+	// Live plot of the most recent states (decimated, rate-limited, and non-blocking)
+
+	olive_t live;
+	if (lp && olive_open(&live,"gnuplot -p",pcols,3,2000,10,0.1,"unset key; set grid; set title \"Lorenz 96 system (live)\"") != 0) {
+		perror("ERROR: Failed to start live plot");
 		return EXIT_FAILURE;
 	}
+#endif //HAVE_GNUPLOT
+
+	// Set some initial values (here we need at least one variable not to be zero)
+
+	double x[N];
+	x[0] = 1.0;
+	for (size_t i=1; i<N; ++i) x[i] = 0.0;
+
+	// Solve the ODE, streaming states to the writer
+
+	printf("%s : lorenz96 (streaming)\n",ode);
 	for (size_t k=0; k<n; ++k) {
-		const double* const xk = x + N*k;
-		for (size_t i=0; i<N; ++i) fprintf(offs," %16.8f",xk[i]);
-		fputc('\n',offs);
+		if (k > 0) ODESTEP(solver,lorenz96,x,N,dt,N,F);
+		ow_push(&w,x);
+#ifdef HAVE_GNUPLOT
+		oplot_update(&plt,(double)k*dt,x);
+		if (lp) olive_update(&live,(double)k*dt,x);
+#endif //HAVE_GNUPLOT
 	}
-	if (fclose(offs) != 0) {
+#ifdef HAVE_GNUPLOT
+	if (lp) {
+		if (olive_close(&live) != 0) fprintf(stderr,"WARNING: live plot failed\n");
+		printf("live frames   = %zu (%zu dropped)\n",live.nframes,live.ndropped);
+	}
+#endif //HAVE_GNUPLOT
+
+	// Finish writing results to file
+
+	if (ow_close(&w) != 0) {
+		perror("ERROR: Failed to write output file");
+		return EXIT_FAILURE;
+	}
+	if ((binary ? otrj_close(offs,w.nrows) : fclose(offs)) != 0) {
 		perror("ERROR: Failed to close output file");
 		return EXIT_FAILURE;
 	}
+	if (binary && opyr_close(&pyr) != 0) {
+		perror("ERROR: Failed to write pyramid file");
+		return EXIT_FAILURE;
+	}
+	printf("writer stalls = %zu\n",w.stalls);
 
-	free(x); // finished with it
-
-	// if Gnuplot available, plot trajectory of first three variables in 3D
+	// if Gnuplot available, plot (decimated) trajectory of first three variables in 3D
 
 #ifdef HAVE_GNUPLOT
+	if (oplot_close(&plt) != 0 || fclose(pfs) != 0) {
+		perror("ERROR: Failed to write plot data file");
+		return EXIT_FAILURE;
+	}
+	char pfmt[32];
+	oplot_format(&plt,pfmt);
+	printf("plot points   = %zu\n",plt.nout);
 	FILE* const gpfs = fopen(gf,"w");
 	if (gpfs == NULL) {
 		perror("ERROR: failed to open Gnuplot command file\n");
@@ -104,7 +195,7 @@ int lorenz96test(int argc, char* argv[])
 	fprintf(gpfs,"set xlabel \"x\"\n");
 	fprintf(gpfs,"set ylabel \"y\"\n");
 	fprintf(gpfs,"set zlabel \"z\"\n");
-	fprintf(gpfs,"splot \"%s\" u 1:2:3 w l not\n",of);
+	fprintf(gpfs,"splot \"%s\" binary format=\"%s\" u 2:3:4 w l not\n",pf,pfmt);
 	if (fclose(gpfs) != 0) {
 		perror("Failed to close Gnuplot command file");
 		return EXIT_FAILURE;
@@ -144,6 +235,7 @@ int outest(int argc, char* argv[])
 	const char* const of   = argc > 7 ?                argv[7]    : "/tmp/ou.asc";
 #ifdef HAVE_GNUPLOT
 	const char* const gf   = argc > 8 ?                argv[8]    : "/tmp/ou.gp";
+	const char* const pf   = argc > 9 ?                argv[9]    : "/tmp/ou.bin"; // downsampled plot data
 #endif //HAVE_GNUPLOT
 
 	// Display command-line  parameters
@@ -189,17 +281,44 @@ int outest(int argc, char* argv[])
 		perror("ERROR: Failed to open output file");
 		return EXIT_FAILURE;
 	}
+	const size_t bsiz = 1<<16;
+	char buf[bsiz];
+	size_t len = 0;
 	for (size_t i=0; i<n; ++i) {
-		fprintf(offs,"%16.8f %16.8f\n",((double)(i+1))*dt, x[i]);
+		if (bsiz-len < 2*(1+OFMT_MAX(16,8))+1) {
+			fwrite(buf,1,len,offs);
+			len = 0;
+		}
+		const double tx[2] = {((double)(i+1))*dt, x[i]};
+		len += ofmt_row(buf+len,tx,2,16,8,0); // as fprintf(offs,"%16.8f %16.8f\n",...)
 	}
-	if (fclose(offs) != 0) {
+	if (fwrite(buf,1,len,offs) != len || fclose(offs) != 0) {
 		perror("ERROR: Failed to close output file");
 		return EXIT_FAILURE;
 	}
 
+#ifdef HAVE_GNUPLOT
+	// Downsampled plot data in Gnuplot binary format
+
+	FILE* const pfs = fopen(pf,"wb");
+	const size_t pcol = 0;
+	oplot_t plt;
+	if (pfs == NULL || oplot_open(&plt,pfs,&pcol,1,n,2000) != 0) {
+		perror("ERROR: Failed to open plot data file");
+		return EXIT_FAILURE;
+	}
+	for (size_t i=0; i<n; ++i) oplot_update(&plt,((double)(i+1))*dt,x+i);
+	if (oplot_close(&plt) != 0 || fclose(pfs) != 0) {
+		perror("ERROR: Failed to write plot data file");
+		return EXIT_FAILURE;
+	}
+	char pfmt[32];
+	oplot_format(&plt,pfmt);
+#endif //HAVE_GNUPLOT
+
 	free(x); // finished with it
 
-	// if Gnuplot available, plot trajectory of first three variables in 3D
+	// if Gnuplot available, plot (downsampled) trajectory
 
 #ifdef HAVE_GNUPLOT
 	FILE* const gpfs = fopen(gf,"w");
@@ -212,7 +331,7 @@ int outest(int argc, char* argv[])
 	fprintf(gpfs,"set title \"Ornstein-Uhlenbeck process (%s solver)\"\n",ode);
 	fprintf(gpfs,"set xlabel \"t (time)\"\n");
 	fprintf(gpfs,"set ylabel \"x\"\n");
-	fprintf(gpfs,"plot \"%s\" u 1:2 w l not\n",of);
+	fprintf(gpfs,"plot \"%s\" binary format=\"%s\" u 1:2 w l not\n",pf,pfmt);
 	if (fclose(gpfs) != 0) {
 		perror("Failed to close Gnuplot command file");
 		return EXIT_FAILURE;
@@ -232,9 +351,2355 @@ int outest(int argc, char* argv[])
 	return EXIT_SUCCESS;
 }
 
+// Streaming statistics for the Lorenz 96 system: accumulate statistics on the fly (without storing the
+// trajectory), and check against statistics computed from the stored trajectory
+
+int statstest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      F   = argc > 1 ?         atof(argv[1])   : 8.0;    // Lorenz 96 F parameter
+	const size_t      N   = argc > 2 ? (size_t)atol(argv[2])   : 5;      // system dimension (number of variables)
+	const double      dt  = argc > 3 ?         atof(argv[3])   : 0.01;   // integration time step
+	const size_t      n   = argc > 4 ? (size_t)atol(argv[4])   : 10000;  // number of integration time steps
+	const char* const ode = argc > 5 ?              argv[5]    : "Heun"; // "Euler", "Heun", or "RK4"
+	const size_t      m   = argc > 6 ? (size_t)atol(argv[6])   : 8;      // number of chunks (for merge/reduce)
+
+	// Display command-line  parameters
+
+	printf("\n*** ODESOLVE test (streaming statistics) ***\n\n");
+	printf("system dimension            =  %zu\n",  N);
+	printf("Lorenz 96 F parameter       =  %g\n",   F);
+	printf("integration step size       =  %g\n",   dt);
+	printf("number of integration steps =  %zu\n",  n);
+	printf("ODE solver                  =  %s\n",   ode);
+	printf("number of chunks            =  %zu\n\n",m);
+
+	// Check command-line parameters
+
+	if (N < 4)  {
+		fprintf(stderr,"ERROR: Lorenz 96 needs at least four variables\n");
+		return EXIT_FAILURE;
+	}
+
+	if (m < 1 || m > n)  {
+		fprintf(stderr,"ERROR: number of chunks must be 1 - %zu\n",n);
+		return EXIT_FAILURE;
+	}
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN) {
+		fprintf(stderr,"ERROR: Unknown ODE solver\n");
+		return EXIT_FAILURE;
+	}
+
+	// Streaming: accumulate statistics in m consecutive chunks, then reduce
+
+	ostats_t* const st = malloc(m*sizeof(ostats_t));
+	ocov_t*   const cv = malloc(m*sizeof(ocov_t));
+	ohist_t*  const hg = malloc(m*sizeof(ohist_t));
+	for (size_t c=0; c<m; ++c) {
+		if (ostats_init(&st[c],N) || ocov_init(&cv[c],N) || ohist_init(&hg[c],N,20,-10.0,15.0)) {
+			perror("ERROR: Failed to allocate statistics accumulators");
+			return EXIT_FAILURE;
+		}
+	}
+
+	double u[N];
+	u[0] = 1.0;
+	for (size_t i=1; i<N; ++i) u[i] = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		if (k > 0) ODESTEP(solver,lorenz96,u,N,dt,N,F);
+		const size_t c = (k*m)/n; // chunk
+		ostats_update(&st[c],u);
+		ocov_update  (&cv[c],u);
+		ohist_update (&hg[c],u);
+	}
+	ostats_reduce(st,m);
+	ocov_reduce  (cv,m);
+	ohist_reduce (hg,m);
+
+	// Stored trajectory: two-pass statistics
+
+	double* const x = calloc(N*n,sizeof(double));
+	x[0] = 1.0;
+	ODE(solver,lorenz96,x,N,n,dt,N,F);
+	double mean[N], var[N], svar[N], cov[N*N];
+	for (size_t i=0; i<N; ++i) mean[i] = 0.0;
+	for (size_t k=0; k<n; ++k) for (size_t i=0; i<N; ++i) mean[i] += x[N*k+i];
+	for (size_t i=0; i<N; ++i) mean[i] /= (double)n;
+	for (size_t i=0; i<N*N; ++i) cov[i] = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		const double* const xk = x + N*k;
+		for (size_t i=0; i<N; ++i) for (size_t j=0; j<N; ++j) cov[N*i+j] += (xk[i]-mean[i])*(xk[j]-mean[j]);
+	}
+	for (size_t i=0; i<N*N; ++i) cov[i] /= (double)(n-1);
+	free(x); // finished with it
+
+	// Report
+
+	double scov[N*N];
+	ostats_var(&st[0],svar);
+	ocov_cov(&cv[0],scov);
+	printf("\nvar      mean        sd          min         max         |mean err|  |var err|\n");
+	for (size_t i=0; i<N; ++i) {
+		var[i] = cov[N*i+i];
+		printf("%3zu %11.6f %11.6f %11.6f %11.6f %11.3e %11.3e\n",i+1,st[0].mean[i],sqrt(svar[i]),st[0].min[i],st[0].max[i],
+			fabs(st[0].mean[i]-mean[i]),fabs(svar[i]-var[i]));
+	}
+	double cerr = 0.0;
+	for (size_t i=0; i<N*N; ++i) cerr = fmax(cerr,fabs(scov[i]-cov[i]));
+	printf("\nmax. covariance error = %.3e\n",cerr);
+	printf("\nhistogram (variable 1, range [%g,%g), %zu bins; underflow = %zu, overflow = %zu):\n\n",hg[0].lo,hg[0].hi,hg[0].nbins,hg[0].under[0],hg[0].over[0]);
+	for (size_t b=0; b<hg[0].nbins; ++b) printf("%8.3f %8zu\n",hg[0].lo+((double)b+0.5)/hg[0].scale,hg[0].count[b]);
+	putchar('\n');
+
+	for (size_t c=0; c<m; ++c) {
+		ostats_free(&st[c]);
+		ocov_free  (&cv[c]);
+		ohist_free (&hg[c]);
+	}
+	free(hg);
+	free(cv);
+	free(st);
+
+	return EXIT_SUCCESS;
+}
+
+// Streaming Welch power spectral density estimate for the Ornstein-Uhlenbeck process, compared with the
+// theoretical (one-sided) spectrum 2*sig^2/(a^2+(2*pi*f)^2). The FFT is also checked against a naive DFT.
+
+int spectest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      a    = argc > 1 ?           atof(argv[1])   : 0.1;     // OU decay parameter
+	const double      sig  = argc > 2 ?           atof(argv[2])   : 1.0;     // OU Wiener noise intensity
+	const double      dt   = argc > 3 ?           atof(argv[3])   : 0.01;    // integration time step
+	const size_t      n    = argc > 4 ?   (size_t)atol(argv[4])   : 1000000; // number of integration time steps
+	const mtuint_t    seed = argc > 5 ? (mtuint_t)atol(argv[5])   : 0;       // PRNG seed (0 for random random seed :-)
+	const char* const ode  = argc > 6 ?                argv[6]    : "Heun";  // "Euler", "Heun", or "RK4"
+	const size_t      L    = argc > 7 ?   (size_t)atol(argv[7])   : 12000;   // Welch window length (50% overlap)
+
+	// Display command-line  parameters
+
+	printf("\n*** ODESOLVE test (streaming Welch PSD) ***\n\n");
+	printf("OU decay parameter          = %g\n",    a   );
+	printf("OU noise intensity          = %g\n",    sig );
+	printf("integration step size       = %g\n",    dt  );
+	printf("number of integration steps = %zu\n",   n   );
+	printf("random seed                 = %zu%s\n",seed,seed?"":" (random random seed :-)");
+	printf("ODE solver                  = %s\n",    ode );
+	printf("Welch window length         = %zu\n\n", L   );
+
+	// Check command-line parameters
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN) {
+		fprintf(stderr,"ERROR: Unknown ODE solver\n");
+		return EXIT_FAILURE;
+	}
+
+	if (L < 2 || L > n) {
+		fprintf(stderr,"ERROR: Welch window length must be 2 - %zu\n",n);
+		return EXIT_FAILURE;
+	}
+
+	// Check FFT against naive DFT
+
+	owelch_t w;
+	if (owelch_init(&w,1,L,L/2,dt) != 0) {
+		perror("ERROR: Failed to allocate Welch estimator");
+		return EXIT_FAILURE;
+	}
+	const size_t Lc = L < 1000 ? L : 1000;
+	offt_t fc;
+	double complex* const zc = malloc(2*Lc*sizeof(double complex));
+	if (offt_init(&fc,Lc) != 0 || zc == NULL) {
+		perror("ERROR: Failed to allocate FFT");
+		return EXIT_FAILURE;
+	}
+	for (size_t t=0; t<Lc; ++t) zc[t] = CMPLX(cos(0.1*(double)(t*t)),sin((double)t));
+	offt(&fc,zc+Lc,zc);
+	double ferr = 0.0;
+	for (size_t k=0; k<Lc; ++k) {
+		double complex y = 0.0;
+		for (size_t t=0; t<Lc; ++t) y += zc[t]*fc.tw[(k*t)%Lc];
+		ferr = fmax(ferr,cabs(y-zc[Lc+k]));
+	}
+	printf("FFT length %zu: max. error vs. naive DFT = %.3e\n\n",Lc,ferr);
+	free(zc);
+	offt_free(&fc);
+
+	// Integrate OU process, feeding the Welch estimator
+
+	mt_t rng;
+	mt_seed(&rng,seed);
+	const double ssig = sig*sqrt(dt); // scaled noise std. dev.
+	double x = 0.0;
+	owelch_update(&w,&x);
+	for (size_t k=1; k<n; ++k) {
+		ODESTEP1(solver,ouproc,x,dt,a);
+		x += ssig*mt_randn(&rng);
+		owelch_update(&w,&x);
+	}
+
+	// Report
+
+	double* const psd = malloc(w.nf*sizeof(double));
+	owelch_psd(&w,psd);
+	printf("segments = %zu\n\n",w.nseg);
+	printf("  frequency     PSD (est.)  PSD (theory)\n");
+	for (size_t k=1; k<w.nf; k *= 2) {
+		const double f = owelch_freq(&w,k);
+		const double om = 2.0*M_PI*f;
+		printf("%11.6f %13.6f %13.6f\n",f,psd[k],2.0*sig*sig/(a*a+om*om));
+	}
+	putchar('\n');
+	free(psd);
+	owelch_free(&w);
+
+	return EXIT_SUCCESS;
+}
+
+// Streaming multi-tau autocorrelation for the Ornstein-Uhlenbeck process, compared with the theoretical
+// autocovariance (sig^2/(2*a))*exp(-a*tau), and (for the unaveraged lags) with the stored trajectory
+
+int corrtest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      a    = argc > 1 ?           atof(argv[1])   : 0.1;     // OU decay parameter
+	const double      sig  = argc > 2 ?           atof(argv[2])   : 1.0;     // OU Wiener noise intensity
+	const double      dt   = argc > 3 ?           atof(argv[3])   : 0.01;    // integration time step
+	const size_t      n    = argc > 4 ?   (size_t)atol(argv[4])   : 1000000; // number of integration time steps
+	const mtuint_t    seed = argc > 5 ? (mtuint_t)atol(argv[5])   : 0;       // PRNG seed (0 for random random seed :-)
+	const char* const ode  = argc > 6 ?                argv[6]    : "Heun";  // "Euler", "Heun", or "RK4"
+	const size_t      T    = argc > 7 ?   (size_t)atol(argv[7])   : 10000;   // maximum lag (steps)
+
+	// Display command-line  parameters
+
+	printf("\n*** ODESOLVE test (streaming multi-tau autocorrelation) ***\n\n");
+	printf("OU decay parameter          = %g\n",    a   );
+	printf("OU noise intensity          = %g\n",    sig );
+	printf("integration step size       = %g\n",    dt  );
+	printf("number of integration steps = %zu\n",   n   );
+	printf("random seed                 = %zu%s\n",seed,seed?"":" (random random seed :-)");
+	printf("ODE solver                  = %s\n",    ode );
+	printf("maximum lag                 = %zu\n\n", T   );
+
+	// Check command-line parameters
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN) {
+		fprintf(stderr,"ERROR: Unknown ODE solver\n");
+		return EXIT_FAILURE;
+	}
+
+	// Integrate OU process, feeding the correlator (and storing the trajectory for comparison)
+
+	ocorr_t c;
+	double* const x = malloc(n*sizeof(double));
+	if (ocorr_init(&c,1,NULL,0,16,2,T) != 0 || x == NULL) {
+		perror("ERROR: Failed to allocate correlator");
+		return EXIT_FAILURE;
+	}
+	mt_t rng;
+	mt_seed(&rng,seed);
+	const double ssig = sig*sqrt(dt); // scaled noise std. dev.
+	double u = 0.0;
+	x[0] = u;
+	ocorr_update(&c,&u);
+	for (size_t k=1; k<n; ++k) {
+		ODESTEP1(solver,ouproc,u,dt,a);
+		u += ssig*mt_randn(&rng);
+		x[k] = u;
+		ocorr_update(&c,&u);
+	}
+
+	// Report
+
+	const size_t nlags = ocorr_nlags(&c);
+	size_t* const lag = malloc(nlags*sizeof(size_t));
+	double* const acf = malloc(nlags*sizeof(double));
+	const size_t K = ocorr_get(&c,lag,acf,1);
+	double mu = 0.0;
+	for (size_t k=0; k<n; ++k) mu += x[k];
+	mu /= (double)n;
+	printf("levels = %zu, lags = %zu\n\n",c.S,K);
+	printf("       lag      autocov. (est.)  autocov. (theory)  autocov. (stored)\n");
+	for (size_t k=0; k<K; ++k) {
+		const double tau = (double)lag[k]*dt;
+		printf("%10.3f %18.6f %18.6f",tau,acf[k],(sig*sig/(2.0*a))*exp(-a*tau));
+		if (lag[k] < c.p) {
+			double r = 0.0;
+			for (size_t t=lag[k]; t<n; ++t) r += x[t-lag[k]]*x[t];
+			printf(" %18.6f",r/(double)(n-lag[k])-mu*mu);
+		}
+		putchar('\n');
+	}
+	putchar('\n');
+	free(acf);
+	free(lag);
+	free(x);
+	ocorr_free(&c);
+
+	return EXIT_SUCCESS;
+}
+
+// Wall-clock time (seconds)
+
+static inline double wtime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (double)ts.tv_sec+1e-9*(double)ts.tv_nsec;
+}
+
+// Lossless trajectory compression for the Lorenz 96 system: compress/decompress the stored trajectory
+// in blocks, checking that it is reproduced exactly, then write a compressed trajectory file through the
+// asynchronous writer and read it back
+
+int comptest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      F   = argc > 1 ?         atof(argv[1])   : 8.0;     // Lorenz 96 F parameter
+	const size_t      N   = argc > 2 ? (size_t)atol(argv[2])   : 5;       // system dimension (number of variables)
+	const double      dt  = argc > 3 ?         atof(argv[3])   : 0.01;    // integration time step
+	const size_t      n   = argc > 4 ? (size_t)atol(argv[4])   : 1000000; // number of integration time steps
+	const char* const ode = argc > 5 ?              argv[5]    : "Heun";  // "Euler", "Heun", or "RK4"
+	const size_t      B   = argc > 6 ? (size_t)atol(argv[6])   : 4096;    // rows per compressed block
+	const char* const of  = argc > 7 ?              argv[7]    : "/tmp/lorenz96.trz";
+
+	// Display command-line  parameters
+
+	printf("\n*** ODESOLVE test (trajectory compression) ***\n\n");
+	printf("system dimension            =  %zu\n",  N);
+	printf("Lorenz 96 F parameter       =  %g\n",   F);
+	printf("integration step size       =  %g\n",   dt);
+	printf("number of integration steps =  %zu\n",  n);
+	printf("ODE solver                  =  %s\n",   ode);
+	printf("rows per block              =  %zu\n\n",B);
+
+	// Check command-line parameters
+
+	if (N < 4)  {
+		fprintf(stderr,"ERROR: Lorenz 96 needs at least four variables\n");
+		return EXIT_FAILURE;
+	}
+
+	if (B < 1)  {
+		fprintf(stderr,"ERROR: rows per block must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN) {
+		fprintf(stderr,"ERROR: Unknown ODE solver\n");
+		return EXIT_FAILURE;
+	}
+
+	// Solve the ODE (stored trajectory)
+
+	double* const x = calloc(N*n,sizeof(double));
+	double* const y = malloc(N*n*sizeof(double));
+	ocomp_t c;
+	if (x == NULL || y == NULL || ocomp_init(&c,B,N) != 0) {
+		perror("ERROR: Failed to allocate memory");
+		return EXIT_FAILURE;
+	}
+	x[0] = 1.0;
+	ODE(solver,lorenz96,x,N,n,dt,N,F);
+
+	// In-memory round trip
+
+	size_t nwords = 0;
+	double tenc = 0.0, tdec = 0.0;
+	for (size_t k=0; k<n; k += B) {
+		const size_t rows = k+B < n ? B : n-k;
+		double t = wtime();
+		const size_t m = ocomp_encode(x+N*k,rows,N,c.buf);
+		tenc += wtime()-t;
+		t = wtime();
+		ocomp_decode(c.buf,rows,N,y+N*k);
+		tdec += wtime()-t;
+		nwords += m+2; // including block header
+	}
+	const double mb = (double)(N*n*sizeof(double))/1e6;
+	printf("\nround trip exact     : %s\n",memcmp(x,y,N*n*sizeof(double)) == 0 ? "yes" : "NO");
+	printf("compressed size      : %.3f MB (raw %.3f MB, ASCII %.3f MB)\n",(double)(8*nwords)/1e6,mb,(double)(17*N*n+n)/1e6);
+	printf("compression ratio    : %.3f (vs. raw), %.3f (vs. ASCII)\n",mb*1e6/(double)(8*nwords),(double)(17*N*n+n)/(double)(8*nwords));
+	printf("encode/decode speed  : %.1f / %.1f MB/s (raw)\n",mb/tenc,mb/tdec);
+
+	// Compressed trajectory file, written on a writer thread
+
+	FILE* const offs = otrj_open(of,N,dt,0.0,OTRJ_XORPRED);
+	owriter_t w;
+	if (offs == NULL || ow_open(&w,offs,N,B,2,ow_xorpred,&c) != 0) {
+		perror("ERROR: Failed to open compressed output file");
+		return EXIT_FAILURE;
+	}
+	for (size_t k=0; k<n; ++k) ow_push(&w,x+N*k);
+	if (ow_close(&w) != 0 || otrj_close(offs,w.nrows) != 0) {
+		perror("ERROR: Failed to write compressed output file");
+		return EXIT_FAILURE;
+	}
+	FILE* const ifs = fopen(of,"rb");
+	otrj_hdr_t hdr;
+	if (ifs == NULL || fread(&hdr,sizeof(hdr),1,ifs) != 1) {
+		perror("ERROR: Failed to read compressed output file");
+		return EXIT_FAILURE;
+	}
+	size_t nread = 0;
+	long rows;
+	while ((rows = ocomp_fread(ifs,&c,y+N*nread,n-nread,N)) > 0) nread += (size_t)rows;
+	fclose(ifs);
+	printf("file round trip exact: %s (%zu of %" PRIu64 " rows)\n\n",rows == 0 && nread == n && hdr.n == n && memcmp(x,y,N*n*sizeof(double)) == 0 ? "yes" : "NO",nread,hdr.n);
+
+	ocomp_free(&c);
+	free(y);
+	free(x);
+
+	return EXIT_SUCCESS;
+}
+
+// Fast ASCII formatting: check byte-identity with fprintf("%16.8f") for Lorenz 96 trajectory values
+// and values of widely varying magnitude, and compare speeds
+
+int fmttest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t   n    = argc > 1 ?   (size_t)atol(argv[1])   : 1000000; // number of rows
+	const size_t   T    = argc > 2 ?   (size_t)atol(argv[2])   : 4;       // number of threads
+	const mtuint_t seed = argc > 3 ? (mtuint_t)atol(argv[3])   : 0;       // PRNG seed (0 for random random seed :-)
+
+	// Display command-line  parameters
+
+	printf("\n*** ODESOLVE test (fast ASCII formatting) ***\n\n");
+	printf("number of rows              = %zu\n",   n   );
+	printf("number of threads           = %zu\n",   T   );
+	printf("random seed                 = %zu%s\n\n",seed,seed?"":" (random random seed :-)");
+
+	if (T < 1) {
+		fprintf(stderr,"ERROR: need at least one thread\n");
+		return EXIT_FAILURE;
+	}
+
+	// Test data: Lorenz 96 trajectory (5 variables), then random values of varying magnitude, including
+	// exact rounding ties and special values
+
+	const size_t N = 5;
+	double* const x = calloc(N*n,sizeof(double));
+	x[0] = 1.0;
+	ODE(RKFOUR,lorenz96,x,N,n/2,0.01,N,8.0);
+	mt_t rng;
+	mt_seed(&rng,seed);
+	for (size_t k=N*(n/2); k<N*n; ++k) {
+		const double r = mt_rand(&rng);
+		x[k] = r < 0.01 ? 0.5e-8*(double)(mt_uint64(&rng)%1000) : (2.0*mt_rand(&rng)-1.0)*pow(10.0,40.0*r-20.0);
+	}
+	x[N*n-1] = NAN;
+	x[N*n-2] = -INFINITY;
+	x[N*n-3] = -0.0;
+	x[N*n-4] = 1.8e19;
+
+	// Format with fprintf, ofmt_write and ofmt_write_par into memory streams
+
+	char* s[3] = {NULL,NULL,NULL};
+	size_t slen[3];
+	double t[3];
+	const size_t bsiz = 1<<20;
+	char* const buf = malloc(bsiz);
+	for (int j=0; j<3; ++j) {
+		FILE* const fs = open_memstream(&s[j],&slen[j]);
+		if (fs == NULL) {
+			perror("ERROR: Failed to open memory stream");
+			return EXIT_FAILURE;
+		}
+		t[j] = wtime();
+		switch (j) {
+			case 0:
+				for (size_t k=0; k<n; ++k) {
+					const double* const xk = x + N*k;
+					for (size_t i=0; i<N; ++i) fprintf(fs," %16.8f",xk[i]);
+					fputc('\n',fs);
+				}
+				break;
+			case 1: ofmt_write(fs,x,n,N,16,8,1,buf,bsiz); break;
+			case 2: ofmt_write_par(fs,x,n,N,16,8,1,T);    break;
+		}
+		fflush(fs);
+		t[j] = wtime()-t[j];
+		fclose(fs);
+	}
+	printf("fprintf      : %8.3f s\n",t[0]);
+	printf("ofmt_write   : %8.3f s (%6.2fx), identical: %s\n",t[1],t[0]/t[1],slen[1] == slen[0] && memcmp(s[0],s[1],slen[0]) == 0 ? "yes" : "NO");
+	printf("ofmt_write_par: %7.3f s (%6.2fx), identical: %s\n\n",t[2],t[0]/t[2],slen[2] == slen[0] && memcmp(s[0],s[2],slen[0]) == 0 ? "yes" : "NO");
+
+	// Fallback (snprintf) path with large widths and precisions
+
+	const double xw[5]  = {1e300,-1.0/3.0,NAN,-INFINITY,-1.7976931348623157e308};
+	const int    ww[5]  = {0,0,400,450,16};
+	const int    pw[5]  = {60,80,3,0,70};
+	int wide = 1;
+	for (int j=0; j<5; ++j) {
+		const size_t m = OFMT_MAX(ww[j],pw[j]);
+		char* const a = malloc(m);
+		char* const b = malloc(m+1);
+		if (a == NULL || b == NULL) {
+			perror("ERROR: Failed to allocate format buffers");
+			return EXIT_FAILURE;
+		}
+		const size_t la = ofmt_fixed(a,xw[j],ww[j],pw[j]);
+		const int lb = snprintf(b,m+1,"%*.*f",ww[j],pw[j],xw[j]);
+		if (lb < 0 || la != (size_t)lb || memcmp(a,b,la) != 0) wide = 0;
+		free(b);
+		free(a);
+	}
+	printf("large width/precision (snprintf fallback), identical: %s\n\n",wide ? "yes" : "NO");
+	for (int j=0; j<3; ++j) free(s[j]);
+	free(buf);
+	free(x);
+
+	return EXIT_SUCCESS;
+}
+
+// Trajectory slicing: extract a time window, decimation and variable subset from a (raw or compressed)
+// trajectory file, as ASCII (time, then values) or as a binary trajectory file (output file name ending
+// in ".trj")
+
+int slicetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const char* const tf   = argc > 1 ?              argv[1]    : "/tmp/lorenz96.trj";
+	const double      t0   = argc > 2 ?         atof(argv[2])   : 0.0;       // start time
+	const double      t1   = argc > 3 ?         atof(argv[3])   : INFINITY;  // end time
+	const size_t      str  = argc > 4 ? (size_t)atol(argv[4])   : 1;         // decimation (row stride)
+	const char* const vl   = argc > 5 ?              argv[5]    : "all";     // comma-separated variables (from 1), or "all"
+	const char* const of   = argc > 6 ?              argv[6]    : "-";       // output file ("-" for stdout)
+
+	// Map trajectory file
+
+	otrj_map_t m;
+	if (otrj_map(&m,tf) != 0) {
+		perror("ERROR: Failed to map trajectory file");
+		return EXIT_FAILURE;
+	}
+
+	// Parse variable list
+
+	size_t nvars = 0;
+	size_t vars[m.N];
+	if (strcmp(vl,"all") == 0) {
+		for (size_t i=0; i<m.N; ++i) vars[nvars++] = i;
+	}
+	else {
+		for (const char* p=vl; *p && nvars < m.N; ) {
+			char* e;
+			const long v = strtol(p,&e,10);
+			if (e == p || v < 1 || (size_t)v > m.N) {
+				fprintf(stderr,"ERROR: bad variable list (variables must be 1 - %zu)\n",m.N);
+				return EXIT_FAILURE;
+			}
+			vars[nvars++] = (size_t)(v-1);
+			p = *e == ',' ? e+1 : e;
+		}
+	}
+
+	// Slice
+
+	const size_t k0 = otrj_row(&m,t0), k1 = otrj_row(&m,t1);
+	otrj_view_t v;
+	if (otrj_slice(&v,&m,k0,k1 > k0 ? k1 : k0,str,0,vars,nvars) != 0) {
+		perror("ERROR: Bad slice");
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr,"%s: %zu variables x %zu rows (%s); slice: rows %zu - %zu, stride %zu, %zu variables -> %zu rows\n",
+		tf,m.N,m.n,m.hdr.type == OTRJ_DOUBLE ? "raw" : m.half != NULL ? "16-bit" : "compressed",k0,k1,str,nvars,v.rows);
+	otrj_willneed(&v);
+	double* const y = malloc(v.rows*nvars*sizeof(double)+1);
+	if (y == NULL || otrj_copy(&v,y) != 0) {
+		perror("ERROR: Failed to copy slice");
+		return EXIT_FAILURE;
+	}
+
+	// Write slice
+
+	const size_t oflen = strlen(of);
+	if (oflen > 4 && strcmp(of+oflen-4,".trj") == 0) {
+		FILE* const offs = otrj_open(of,nvars,m.hdr.h*(double)str,m.hdr.t0+m.hdr.h*(double)k0,OTRJ_DOUBLE);
+		if (offs == NULL || fwrite(y,sizeof(double),v.rows*nvars,offs) != v.rows*nvars || otrj_close(offs,v.rows) != 0) {
+			perror("ERROR: Failed to write output file");
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		FILE* const offs = strcmp(of,"-") == 0 ? stdout : fopen(of,"w");
+		const size_t bsiz = (nvars+1)*(1+OFMT_MAX(16,8))+1;
+		char* const buf = malloc(bsiz);
+		double* const row = malloc((nvars+1)*sizeof(double));
+		if (offs == NULL || buf == NULL || row == NULL) {
+			perror("ERROR: Failed to open output file");
+			return EXIT_FAILURE;
+		}
+		for (size_t r=0; r<v.rows; ++r) {
+			row[0] = m.hdr.t0+m.hdr.h*(double)(k0+str*r);
+			memcpy(row+1,y+nvars*r,nvars*sizeof(double));
+			const size_t len = ofmt_row(buf,row,nvars+1,16,8,0);
+			if (fwrite(buf,1,len,offs) != len) {
+				perror("ERROR: Failed to write output file");
+				return EXIT_FAILURE;
+			}
+		}
+		if (offs != stdout && fclose(offs) != 0) {
+			perror("ERROR: Failed to close output file");
+			return EXIT_FAILURE;
+		}
+		free(row);
+		free(buf);
+	}
+
+	free(y);
+	otrj_unmap(&m);
+
+	return EXIT_SUCCESS;
+}
+
+// Trajectory pyramid zoom: fetch min/max/mean of a variable over a time window from the pyramid file
+// built alongside a raw trajectory file (see lorenz96test), at the finest level giving at most maxrec
+// records, and check them against the full-resolution trajectory
+
+int pyrtest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const char* const tf   = argc > 1 ?              argv[1]    : "/tmp/lorenz96.trj";
+	const double      t0   = argc > 2 ?         atof(argv[2])   : 0.0;       // start time
+	const double      t1   = argc > 3 ?         atof(argv[3])   : INFINITY;  // end time
+	const size_t      mrec = argc > 4 ? (size_t)atol(argv[4])   : 20;        // maximum records to fetch
+	const size_t      var  = argc > 5 ? (size_t)atol(argv[5])   : 1;         // variable (from 1)
+
+	// Map trajectory and pyramid files
+
+	otrj_map_t m;
+	if (otrj_map(&m,tf) != 0 || m.hdr.type != OTRJ_DOUBLE) {
+		perror("ERROR: Failed to map (raw) trajectory file");
+		return EXIT_FAILURE;
+	}
+	char pf[strlen(tf)+5];
+	snprintf(pf,sizeof(pf),"%s.pyr",tf);
+	opyr_map_t p;
+	if (opyr_map(&p,pf) != 0 || p.N != m.N || p.hdr.n != m.n) {
+		perror("ERROR: Failed to map pyramid file");
+		return EXIT_FAILURE;
+	}
+	if (var < 1 || var > m.N) {
+		fprintf(stderr,"ERROR: variable must be 1 - %zu\n",m.N);
+		return EXIT_FAILURE;
+	}
+	const size_t i = var-1, N = m.N;
+
+	// Zoom
+
+	const size_t k0 = otrj_row(&m,t0), k1 = otrj_row(&m,t1);
+	const size_t l = opyr_level(&p,k0,k1,mrec);
+	size_t r0, nrec;
+	const double* const rec = opyr_records(&p,l,k0,k1,&r0,&nrec);
+	printf("\n*** ODESOLVE test (trajectory pyramid) ***\n\n");
+	printf("%s: %zu variables x %zu rows; %zu levels (factor %zu)\n",pf,N,p.hdr.n,p.L,p.f);
+	printf("rows %zu - %zu: level %zu (%zu rows/record), records %zu - %zu\n\n",k0,k1,l,p.span[l],r0,r0+nrec);
+	printf("          t           min           max          mean\n");
+	int ok = 1;
+	for (size_t r=0; r<nrec; ++r) {
+		const double* const q = rec+3*N*r;
+		const size_t ka = p.span[l]*(r0+r), kb = ka+p.span[l] < m.n ? ka+p.span[l] : m.n;
+		double mn = INFINITY, mx = -INFINITY, sm = 0.0;
+		for (size_t k=ka; k<kb; ++k) {
+			const double y = m.data[N*k+i];
+			mn = y < mn ? y : mn;
+			mx = y > mx ? y : mx;
+			sm += y;
+		}
+		if (q[i] != mn || q[N+i] != mx || fabs(q[2*N+i]-sm/(double)(kb-ka)) > 1e-9*(1.0+fabs(mx)+fabs(mn))) ok = 0;
+		printf("%11.4f  %12.6f  %12.6f  %12.6f\n",m.hdr.t0+m.hdr.h*(double)ka,q[i],q[N+i],q[2*N+i]);
+	}
+	printf("\nmatches trajectory: %s\n\n",ok ? "yes" : "NO");
+
+	opyr_unmap(&p);
+	otrj_unmap(&m);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Single- and mixed-precision integration (ODEF/ODEM, ODE1F/ODE1M): accuracy against the double
+// path, and timings
+
+static inline void lorenz96f(float* const xdot, const float* const x, const size_t N, const float F)
+{
+	xdot[0] = (x[1]-x[N-2])*x[N-1]-x[0]+F;
+	xdot[1] = (x[2]-x[N-1])*x[0]-x[1]+F;
+	for (size_t i=2; i<N-1; ++i) xdot[i] = (x[i+1]-x[i-2])*x[i-1]-x[i]+F;
+	xdot[N-1] = (x[0]-x[N-3])*x[N-2]-x[N-1]+F;
+}
+
+static inline double decay(const double x, const double a)
+{
+	return -a*x;
+}
+
+static inline float decayf(const float x, const float a)
+{
+	return -a*x;
+}
+
+int prectest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t      N   = argc > 1 ? (size_t)atol(argv[1])   : 1000;   // Lorenz 96 system dimension
+	const double      dt  = argc > 2 ?         atof(argv[2])   : 0.001;  // integration time step
+	const size_t      n   = argc > 3 ? (size_t)atol(argv[3])   : 2000;   // number of integration time steps
+	const char* const ode = argc > 4 ?              argv[4]    : "RK4";  // "Euler", "Heun", or "RK4"
+	const size_t      n1  = argc > 5 ? (size_t)atol(argv[5])   : 1000000;// number of steps for 1-dimensional decay
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (single and mixed precision) ***\n\n");
+	printf("system dimension            =  %zu\n",  N);
+	printf("integration step size       =  %g\n",   dt);
+	printf("number of integration steps =  %zu\n",  n);
+	printf("ODE solver                  =  %s\n",   ode);
+	printf("1D decay integration steps  =  %zu\n\n",n1);
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN || N < 4) {
+		fprintf(stderr,"ERROR: Unknown ODE solver, or N < 4\n");
+		return EXIT_FAILURE;
+	}
+
+	// Lorenz 96 (F = 8) in double, float and mixed precision, from the same initial state
+
+	double* const x  = calloc(N*n,sizeof(double));
+	float*  const xf = calloc(N*n,sizeof(float));
+	float*  const xm = calloc(N*n,sizeof(float));
+	if (x == NULL || xf == NULL || xm == NULL) {
+		perror("ERROR: Failed to allocate memory");
+		return EXIT_FAILURE;
+	}
+	mt_t rng;
+	mt_seed(&rng,2357);
+	for (size_t i=0; i<N; ++i) x[i] = 8.0+mt_randn(&rng);
+	for (size_t i=0; i<N; ++i) xm[i] = xf[i] = (float)x[i];
+	double t = wtime();
+	ODE(solver,lorenz96,x,N,n,dt,N,8.0);
+	const double td = wtime()-t;
+	t = wtime();
+	ODEF(solver,lorenz96f,xf,N,n,dt,N,8.0f);
+	const double tf = wtime()-t;
+	t = wtime();
+	ODEM(solver,lorenz96f,xm,N,n,dt,N,8.0f);
+	const double tm = wtime()-t;
+	double ef = 0.0, em = 0.0;
+	for (size_t k=0; k<N*n; ++k) {
+		const double df = fabs((double)xf[k]-x[k]), dm = fabs((double)xm[k]-x[k]);
+		ef = df > ef ? df : ef;
+		em = dm > em ? dm : em;
+	}
+	printf("\nLorenz 96   time (s)  speedup   max abs error\n");
+	printf("double    %9.4f\n",td);
+	printf("float     %9.4f  %6.2fx   %12.4e\n",tf,td/tf,ef);
+	printf("mixed     %9.4f  %6.2fx   %12.4e\n\n",tm,td/tm,em);
+	free(xm);
+	free(xf);
+	free(x);
+
+	// Exponential decay x' = -x, with many small steps: float state updates stagnate, mixed do not
+
+	double* const y  = calloc(n1,sizeof(double));
+	float*  const yf = calloc(n1,sizeof(float));
+	float*  const ym = calloc(n1,sizeof(float));
+	if (y == NULL || yf == NULL || ym == NULL) {
+		perror("ERROR: Failed to allocate memory");
+		return EXIT_FAILURE;
+	}
+	const double h1 = 1.0/(double)n1;
+	y[0] = 1.0;
+	yf[0] = ym[0] = 1.0f;
+	ODE1(solver,decay,y,n1,h1,1.0);
+	ODE1F(solver,decayf,yf,n1,h1,1.0f);
+	ODE1M(solver,decayf,ym,n1,h1,1.0f);
+	const double yx = exp(-h1*(double)(n1-1));
+	printf("\ndecay x(1): exact %.8f  double %.8f  float %.8f  mixed %.8f\n\n",yx,y[n1-1],(double)yf[n1-1],(double)ym[n1-1]);
+	free(ym);
+	free(yf);
+	free(y);
+
+	return EXIT_SUCCESS;
+}
+
+// Half-precision (float16) and bfloat16 trajectory storage: integrate Lorenz 96 in double, storing states
+// as 16-bit values; storage error and conversion speed, and round trip through a trajectory file
+
+int halftest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t      N   = argc > 1 ? (size_t)atol(argv[1])   : 50;      // system dimension
+	const double      dt  = argc > 2 ?         atof(argv[2])   : 0.01;    // integration time step
+	const size_t      n   = argc > 3 ? (size_t)atol(argv[3])   : 100000;  // number of integration time steps
+	const char* const of  = argc > 4 ?              argv[4]    : "/tmp/lorenz96h.trj";
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (16-bit trajectory storage) ***\n\n");
+	printf("system dimension            =  %zu\n",  N);
+	printf("integration step size       =  %g\n",   dt);
+	printf("number of integration steps =  %zu\n\n",n);
+
+	if (N < 4) {
+		fprintf(stderr,"ERROR: Lorenz 96 needs at least four variables\n");
+		return EXIT_FAILURE;
+	}
+
+	// Integrate (RK4, F = 8), storing the trajectory in double, float16 and bfloat16
+
+	double*   const x  = malloc(N*n*sizeof(double));
+	uint16_t* const xh = malloc(N*n*sizeof(uint16_t));
+	uint16_t* const xb = malloc(N*n*sizeof(uint16_t));
+	double*   const y  = malloc(N*n*sizeof(double));
+	if (x == NULL || xh == NULL || xb == NULL || y == NULL) {
+		perror("ERROR: Failed to allocate memory");
+		return EXIT_FAILURE;
+	}
+	memset(y,0,N*n*sizeof(double)); // pre-fault, for unpack timing
+	double u[N];
+	for (size_t i=0; i<N; ++i) u[i] = i == 0 ? 1.0 : 0.0;
+	double tpack = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		if (k > 0) ODESTEP(RKFOUR,lorenz96,u,N,dt,N,8.0);
+		memcpy(x+N*k,u,N*sizeof(double));
+		const double t = wtime();
+		ohalf_pack(xh+N*k,u,N,OTRJ_FLOAT16);
+		ohalf_pack(xb+N*k,u,N,OTRJ_BFLOAT16);
+		tpack += wtime()-t;
+	}
+
+	// Storage error (absolute, and relative to the value range)
+
+	double xmax = 0.0;
+	for (size_t k=0; k<N*n; ++k) xmax = fabs(x[k]) > xmax ? fabs(x[k]) : xmax;
+	printf("storage (MB): double %.1f, 16-bit %.1f\n",(double)(N*n*sizeof(double))/1e6,(double)(N*n*sizeof(uint16_t))/1e6);
+	printf("pack time   : %.2f ns/value (both types)\n\n",1e9*tpack/(double)(2*N*n));
+	const otrj_type_t types[2] = {OTRJ_FLOAT16,OTRJ_BFLOAT16};
+	const uint16_t* const xs[2] = {xh,xb};
+	for (int j=0; j<2; ++j) {
+		const double t = wtime();
+		ohalf_unpack(y,xs[j],N*n,types[j]);
+		const double tu = wtime()-t;
+		double emax = 0.0;
+		for (size_t k=0; k<N*n; ++k) emax = fabs(y[k]-x[k]) > emax ? fabs(y[k]-x[k]) : emax;
+		printf("%-9s: max abs error %.3e (%.3e of range), unpack %.2f ns/value\n",j == 0 ? "float16" : "bfloat16",emax,emax/xmax,1e9*tu/(double)(N*n));
+	}
+
+	// Write a float16 trajectory file with the asynchronous writer, and read it back
+
+	otrj_type_t type = OTRJ_FLOAT16;
+	FILE* const offs = otrj_open(of,N,dt,0.0,type);
+	owriter_t w;
+	if (offs == NULL || ow_open(&w,offs,N,4096,2,ow_half,&type) != 0) {
+		perror("ERROR: Failed to open output file");
+		return EXIT_FAILURE;
+	}
+	for (size_t k=0; k<n; ++k) ow_push(&w,x+N*k);
+	if (ow_close(&w) != 0 || otrj_close(offs,w.nrows) != 0) {
+		perror("ERROR: Failed to write output file");
+		return EXIT_FAILURE;
+	}
+	otrj_map_t m;
+	otrj_view_t v;
+	if (otrj_map(&m,of) != 0 || otrj_slice(&v,&m,0,m.n,1,0,NULL,N) != 0 || otrj_copy(&v,y) != 0) {
+		perror("ERROR: Failed to read back trajectory file");
+		return EXIT_FAILURE;
+	}
+	int ok = m.n == n;
+	for (size_t k=0; ok && k<N*n; ++k) ok = y[k] == (double)ohalf_to_float(xh[k]);
+	printf("\n%s: %zu bytes, read back identical: %s\n\n",of,m.maplen,ok ? "yes" : "NO");
+	otrj_unmap(&m);
+
+	free(y);
+	free(xb);
+	free(xh);
+	free(x);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Non-autonomous (periodically forced) systems: ODET, ODE1T and ODESTEPT, checked against exact
+// solutions; observed convergence orders confirm the stage times
+
+static inline void forced(double* const xdot, const double t, const double* const x, const double* const a, const double w)
+{
+	xdot[0] = -a[0]*x[0]+cos(w*t);
+	xdot[1] = -a[1]*x[1]+sin(w*t);
+}
+
+static inline double forced1(const double t, const double x, const double a, const double w)
+{
+	return -a*x+cos(w*t);
+}
+
+// Exact solution of x' = -a*x+cos(w*t) (s = 0) or x' = -a*x+sin(w*t) (s = 1) at time t0+T, from x0 at t0
+
+static inline double forced_exact(const double t0, const double T, const double x0, const double a, const double w, const int s)
+{
+	const double d  = a*a+w*w;
+	const double t1 = t0+T;
+	const double p0 = s ? (a*sin(w*t0)-w*cos(w*t0))/d : (a*cos(w*t0)+w*sin(w*t0))/d; // particular solution
+	const double p1 = s ? (a*sin(w*t1)-w*cos(w*t1))/d : (a*cos(w*t1)+w*sin(w*t1))/d;
+	return p1+(x0-p0)*exp(-a*T);
+}
+
+int forcetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      w   = argc > 1 ?         atof(argv[1])   : 5.0;    // forcing angular frequency
+	const double      T   = argc > 2 ?         atof(argv[2])   : 10.0;   // integration time
+	const size_t      n0  = argc > 3 ? (size_t)atol(argv[3])   : 200;    // number of steps (coarsest)
+	const double      t0  = argc > 4 ?         atof(argv[4])   : 0.0;    // initial time
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (non-autonomous forcing) ***\n\n");
+	printf("forcing frequency           =  %g\n",  w);
+	printf("integration time            =  %g\n",  T);
+	printf("number of integration steps =  %zu, %zu, %zu\n",n0,2*n0,4*n0);
+	printf("initial time                =  %g\n\n",t0);
+
+	const double a[2] = {1.0,2.0};
+	const double x0[2] = {1.0,0.5};
+	const ode_t solvers[3] = {EULER,HEUN,RKFOUR};
+	const char* const names[3] = {"Euler","Heun","RK4"};
+	double err[3][3], err1[3][3], errs[3][3];
+	for (int j=0; j<3; ++j) {
+		for (int r=0; r<3; ++r) {
+			const size_t n = (n0<<r)+1;
+			const double h = T/(double)(n-1);
+			double* const x = calloc(2*n,sizeof(double));
+			double* const y = calloc(n,sizeof(double));
+			if (x == NULL || y == NULL) {
+				perror("ERROR: Failed to allocate memory");
+				return EXIT_FAILURE;
+			}
+			x[0] = x0[0];
+			x[1] = x0[1];
+			y[0] = x0[0];
+			ODET(solvers[j],forced,x,2,n,h,t0,a,w);
+			ODE1T(solvers[j],forced1,y,n,h,t0,a[0],w);
+			double u[2] = {x0[0],x0[1]};
+			for (size_t k=0; k<n-1; ++k) ODESTEPT(solvers[j],forced,u,2,t0+(double)k*h,h,a,w);
+			const double ex[2] = {forced_exact(t0,T,x0[0],a[0],w,0),forced_exact(t0,T,x0[1],a[1],w,1)};
+			err[j][r]  = fmax(fabs(x[2*(n-1)]-ex[0]),fabs(x[2*(n-1)+1]-ex[1]));
+			err1[j][r] = fabs(y[n-1]-ex[0]);
+			errs[j][r] = fmax(fabs(u[0]-x[2*(n-1)]),fabs(u[1]-x[2*(n-1)+1]));
+			free(y);
+			free(x);
+		}
+	}
+	printf("\nsolver        error (ODET)                     order    error (ODE1T)  order   |ODESTEPT-ODET|\n");
+	for (int j=0; j<3; ++j) {
+		printf("%-6s  %10.3e %10.3e %10.3e  %6.2f  %10.3e  %6.2f   %10.3e\n",names[j],err[j][0],err[j][1],err[j][2],
+			log2(err[j][1]/err[j][2]),err1[j][2],log2(err1[j][1]/err1[j][2]),fmax(errs[j][0],fmax(errs[j][1],errs[j][2])));
+	}
+	printf("\n");
+
+	return EXIT_SUCCESS;
+}
+
+// Recorded forcing: the forced linear system of forcetest, driven by forcing sampled into a (memory-
+// mapped) trajectory file, interpolated to the stage times
+
+static inline void driven(double* const xdot, const double t, const double* const x, const double* const a, oforce_t* const F)
+{
+	double u[2];
+	oforce_eval(F,t,u);
+	xdot[0] = -a[0]*x[0]+u[0];
+	xdot[1] = -a[1]*x[1]+u[1];
+}
+
+int drivetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      w   = argc > 1 ?         atof(argv[1])   : 5.0;    // forcing angular frequency
+	const double      T   = argc > 2 ?         atof(argv[2])   : 100.0;  // integration time
+	const double      hf  = argc > 3 ?         atof(argv[3])   : 0.01;   // forcing sample interval
+	const double      h   = argc > 4 ?         atof(argv[4])   : 0.005;  // integration step size
+	const char* const ode = argc > 5 ?              argv[5]    : "RK4";  // "Euler", "Heun", or "RK4"
+	const char* const ff  = argc > 6 ?              argv[6]    : "/tmp/forcing.trj";
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (recorded forcing) ***\n\n");
+	printf("forcing frequency           =  %g\n",  w);
+	printf("integration time            =  %g\n",  T);
+	printf("forcing sample interval     =  %g\n",  hf);
+	printf("integration step size       =  %g\n",  h);
+	printf("ODE solver                  =  %s\n\n",ode);
+
+	const ode_t solver = str2ode(ode);
+	if (solver == UNKNOWN) {
+		fprintf(stderr,"ERROR: Unknown ODE solver\n");
+		return EXIT_FAILURE;
+	}
+
+	// Record forcing (cos(wt), sin(wt)) to file
+
+	const size_t nf = (size_t)ceil(T/hf)+1;
+	FILE* const ffs = otrj_open(ff,2,hf,0.0,OTRJ_DOUBLE);
+	if (ffs == NULL) {
+		perror("ERROR: Failed to open forcing file");
+		return EXIT_FAILURE;
+	}
+	for (size_t k=0; k<nf; ++k) {
+		const double u[2] = {cos(w*hf*(double)k),sin(w*hf*(double)k)};
+		if (fwrite(u,sizeof(double),2,ffs) != 2) {
+			perror("ERROR: Failed to write forcing file");
+			return EXIT_FAILURE;
+		}
+	}
+	if (otrj_close(ffs,nf) != 0) {
+		perror("ERROR: Failed to close forcing file");
+		return EXIT_FAILURE;
+	}
+	printf("%s: %zu samples\n",ff,nf);
+
+	// Integrate with interpolated recorded forcing, and with exact forcing
+
+	const size_t n = (size_t)round(T/h)+1;
+	const double a[2] = {1.0,2.0};
+	const double x0[2] = {1.0,0.5};
+	const double ex[2] = {forced_exact(0.0,h*(double)(n-1),x0[0],a[0],w,0),forced_exact(0.0,h*(double)(n-1),x0[1],a[1],w,1)};
+	const char* const inames[3] = {"hold","linear","cubic"};
+	printf("\nforcing            time (s)    error\n");
+	for (int j=0; j<4; ++j) {
+		oforce_t F;
+		if (j < 3 && oforce_open(&F,ff,(oforce_interp_t)j,4096) != 0) {
+			perror("ERROR: Failed to map forcing file");
+			return EXIT_FAILURE;
+		}
+		double x[2] = {x0[0],x0[1]};
+		const double t = wtime();
+		for (size_t k=0; k<n-1; ++k) {
+			if (j < 3) ODESTEPT(solver,driven,x,2,h*(double)k,h,a,&F)
+			else       ODESTEPT(solver,forced,x,2,h*(double)k,h,a,w)
+		}
+		const double tt = wtime()-t;
+		if (j < 3) oforce_close(&F);
+		printf("%-16s  %8.4f   %10.3e\n",j < 3 ? inames[j] : "exact (analytic)",tt,fmax(fabs(x[0]-ex[0]),fabs(x[1]-ex[1])));
+	}
+	printf("\n");
+
+	return EXIT_SUCCESS;
+}
+
+// Delay differential equations: x'(t) = -x(t-tau) with constant history x = 1 (t <= 0), against the
+// exact (method of steps) solution; and a state-dependent delay tau(x) = tau*(1+x^2/2), for which
+// convergence is checked by step halving
+
+static inline void dde_const(double* const xdot, const double t, const double* const x, odde_t* const d, const double tau)
+{
+	(void)x;
+	xdot[0] = -odde_lag(d,t-tau,0);
+}
+
+static inline void dde_state(double* const xdot, const double t, const double* const x, odde_t* const d, const double tau)
+{
+	xdot[0] = -odde_lag(d,t-tau*(1.0+0.5*x[0]*x[0]),0);
+}
+
+static inline void dde_phi(const double t, double* const x, void* const arg)
+{
+	(void)t;
+	(void)arg;
+	x[0] = 1.0;
+}
+
+static inline double dde_exact(const double t, const double tau) // sum_{k=0}^{floor(t/tau)+1} (-(t-(k-1)tau))^k/k!
+{
+	double x = 0.0, fac = 1.0;
+	for (size_t k=0; k <= (size_t)floor(t/tau)+1; ++k) {
+		if (k > 0) fac *= (double)k;
+		x += pow(-(t-((double)k-1.0)*tau),(double)k)/fac;
+	}
+	return x;
+}
+
+int ddetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double      tau = argc > 1 ?         atof(argv[1])   : 1.0;    // delay
+	const double      T   = argc > 2 ?         atof(argv[2])   : 10.0;   // integration time
+	const size_t      n0  = argc > 3 ? (size_t)atol(argv[3])   : 100;    // number of steps (coarsest)
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (delay differential equations) ***\n\n");
+	printf("delay                       =  %g\n",  tau);
+	printf("integration time            =  %g\n",  T);
+	printf("number of integration steps =  %zu, %zu, %zu\n\n",n0,2*n0,4*n0);
+
+	const ode_t solvers[3] = {EULER,HEUN,RKFOUR};
+	const char* const names[3] = {"Euler","Heun","RK4"};
+	printf("solver  error (constant delay)             order   state-dependent x(T)                   order\n");
+	for (int j=0; j<3; ++j) {
+		double err[3], xs[3];
+		size_t H = 0;
+		for (int r=0; r<3; ++r) {
+			const size_t n = n0<<r;
+			const double h = T/(double)n;
+			odde_t d, ds;
+			if (odde_init(&d,1,tau,h,0.0,dde_phi,NULL) != 0 || odde_init(&ds,1,tau*1.5,h,0.0,dde_phi,NULL) != 0) {
+				perror("ERROR: Failed to allocate history");
+				return EXIT_FAILURE;
+			}
+			double x[1] = {1.0}, y[1] = {1.0};
+			for (size_t k=0; k<n; ++k) {
+				DDESTEP(solvers[j],dde_const,x,1,h,&d,tau);
+				DDESTEP(solvers[j],dde_state,y,1,h,&ds,tau);
+			}
+			err[r] = fabs(x[0]-dde_exact(T,tau));
+			xs[r]  = y[0];
+			H = d.H;
+			odde_free(&ds);
+			odde_free(&d);
+		}
+		printf("%-6s  %10.3e %10.3e %10.3e  %5.2f   %12.9f %12.9f %12.9f  %5.2f\n",names[j],err[0],err[1],err[2],log2(err[1]/err[2]),
+			xs[0],xs[1],xs[2],log2(fabs(xs[1]-xs[0])/fabs(xs[2]-xs[1])));
+		if (j == 2) printf("\nhistory length: %zu steps (of %zu)\n\n",H,n0<<2);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Leaky integrate-and-fire ensemble with OU input (hybrid system: threshold, spike-time interpolation,
+// reset and refractory period). Spike timing accuracy is checked against the analytic firing period
+// for constant suprathreshold input, at several step sizes; then a noisy ensemble is timed.
+
+int liftest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t      M   = argc > 1 ? (size_t)atol(argv[1])   : 100000; // number of neurons
+	const double      h   = argc > 2 ?         atof(argv[2])   : 0.1;    // integration step size (ms)
+	const size_t      n   = argc > 3 ? (size_t)atol(argv[3])   : 2000;   // number of integration time steps
+	const double      sig = argc > 4 ?         atof(argv[4])   : 8.0;    // input noise standard deviation (mV)
+	const double      mu  = argc > 5 ?         atof(argv[5])   : 16.0;   // input mean (mV)
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (integrate-and-fire ensemble) ***\n\n");
+	printf("number of neurons           =  %zu\n",  M);
+	printf("integration step size       =  %g ms\n",h);
+	printf("number of integration steps =  %zu\n",  n);
+	printf("input noise s.d.            =  %g mV\n",sig);
+	printf("input mean                  =  %g mV\n\n",mu);
+
+	olif_par_t p = {.tau = 20.0, .EL = -70.0, .vth = -50.0, .vreset = -65.0, .tref = 2.0, .mu = 30.0, .tauI = 5.0, .sig = 0.0};
+
+	// Deterministic firing period, against analytic
+
+	const double Tp = p.tref+p.tau*log((p.EL+p.mu-p.vreset)/(p.EL+p.mu-p.vth));
+	printf("constant input %g mV: analytic period %.6f ms\n",p.mu,Tp);
+	const double hs[3] = {0.1,0.5,1.0};
+	for (int j=0; j<3; ++j) {
+		olif_t e;
+		if (olif_init(&e,1,&p) != 0) {
+			perror("ERROR: Failed to allocate neurons");
+			return EXIT_FAILURE;
+		}
+		double tfirst = -1.0, tlast = -1.0;
+		size_t nsp = 0;
+		for (size_t k=0; k<(size_t)(1000.0/hs[j]); ++k) {
+			if (olif_step(&e,(double)k*hs[j],hs[j],NULL) > 0) {
+				if (tfirst < 0.0) tfirst = e.spt[0];
+				tlast = e.spt[0];
+				++nsp;
+			}
+		}
+		const double T = (tlast-tfirst)/(double)(nsp-1);
+		printf("h = %3.1f ms: mean period %.6f ms (rel. error %.2e, %zu spikes)\n",hs[j],T,fabs(T-Tp)/Tp,nsp);
+		olif_free(&e);
+	}
+
+	// Noisy ensemble
+
+	p.mu  = mu;
+	p.sig = sig;
+	olif_t e;
+	double* const z = malloc(M*sizeof(double));
+	if (z == NULL || olif_init(&e,M,&p) != 0) {
+		perror("ERROR: Failed to allocate neurons");
+		return EXIT_FAILURE;
+	}
+	mt_t rng;
+	mt_seed(&rng,1234);
+	double tstep = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		for (size_t i=0; i<M; ++i) z[i] = mt_randn(&rng);
+		const double t = wtime();
+		olif_step(&e,(double)k*h,h,z);
+		tstep += wtime()-t;
+	}
+	printf("\nensemble: %zu spikes, mean rate %.3f Hz; update %.2f ns/neuron/step\n\n",
+		e.ntot,1000.0*(double)e.ntot/((double)M*(double)n*h),1e9*tstep/((double)M*(double)n));
+	olif_free(&e);
+	free(z);
+
+	return EXIT_SUCCESS;
+}
+
+// Network of bistable nodes with diffusive coupling: naive edge-list RHS, and SpMV (CSR or
+// SELL-C-sigma) RHS
+
+typedef struct {
+	size_t          N;   // number of nodes
+	size_t          nnz; // number of connections
+	const uint32_t* row; // connection targets
+	const uint32_t* col; // connection sources
+	const double*   w;   // connection weights
+} edges_t;
+
+static inline void netnaive(double* const xdot, const double* const x, const edges_t* const E, const double* const b, const double g)
+{
+	for (size_t i=0; i<E->N; ++i) xdot[i] = x[i]-x[i]*x[i]*x[i]+b[i];
+	for (size_t k=0; k<E->nnz; ++k) xdot[E->row[k]] += g*E->w[k]*(x[E->col[k]]-x[E->row[k]]);
+}
+
+static inline void netspmv(double* const xdot, const double* const x, const onet_t* const W, const double* const b, const double g)
+{
+	onet_spmv(W,x,xdot);
+	for (size_t i=0; i<W->N; ++i) xdot[i] = x[i]-x[i]*x[i]*x[i]+b[i]+g*(xdot[i]-W->deg[i]*x[i]);
+}
+
+// Small-world network (ring lattice of degree 2K, connections rewired with probability p) of N nodes,
+// with node labels shuffled (as for networks read from data); the coupling RHS is timed for the naive
+// edge-list loop, CSR, and CSR/SELL-C-sigma after RCM reordering, and the network is integrated with
+// the naive and the fastest RHS, and the final states compared.
+
+int nettest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t N     = argc > 1 ? (size_t)atol(argv[1]) : 100000; // number of nodes
+	const size_t K     = argc > 2 ? (size_t)atol(argv[2]) : 8;      // lattice neighbours on each side
+	const double prew  = argc > 3 ?         atof(argv[3]) : 0.01;   // rewiring probability
+	const double g     = argc > 4 ?         atof(argv[4]) : 0.1;    // coupling strength
+	const double h     = argc > 5 ?         atof(argv[5]) : 0.01;   // integration step size
+	const size_t n     = argc > 6 ? (size_t)atol(argv[6]) : 100;    // number of integration time steps
+	const size_t sigma = argc > 7 ? (size_t)atol(argv[7]) : 256;    // SELL-C-sigma sorting window
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (sparse-coupled network) ***\n\n");
+	printf("number of nodes             =  %zu\n",N);
+	printf("lattice neighbours          =  2 x %zu\n",K);
+	printf("rewiring probability        =  %g\n",prew);
+	printf("coupling strength           =  %g\n",g);
+	printf("integration step size       =  %g\n",h);
+	printf("number of integration steps =  %zu\n",n);
+	printf("SELL-C-sigma window         =  %zu (C = %d)\n\n",sigma,ONET_C);
+
+	// Symmetric small-world network, shuffled labels, random weights
+
+	mt_t rng;
+	mt_seed(&rng,4321);
+	const size_t nnz = 2*N*K;
+	uint32_t* const row  = malloc(nnz*sizeof(uint32_t));
+	uint32_t* const col  = malloc(nnz*sizeof(uint32_t));
+	double*   const w    = malloc(nnz*sizeof(double));
+	uint32_t* const lab  = malloc(N*sizeof(uint32_t));
+	uint32_t* const perm = malloc(N*sizeof(uint32_t));
+	double*   const b    = malloc(N*sizeof(double));
+	double*   const bp   = malloc(N*sizeof(double));
+	double*   const x0   = malloc(N*sizeof(double));
+	double*   const x    = malloc(N*sizeof(double));
+	double*   const y    = malloc(N*sizeof(double));
+	double*   const z    = malloc(N*sizeof(double));
+	if (row == NULL || col == NULL || w == NULL || lab == NULL || perm == NULL || b == NULL || bp == NULL || x0 == NULL || x == NULL || y == NULL || z == NULL) {
+		perror("ERROR: Failed to allocate network");
+		return EXIT_FAILURE;
+	}
+	for (size_t i=0; i<N; ++i) lab[i] = (uint32_t)i;
+	for (size_t i=N-1; i>0; --i) { // Fisher-Yates shuffle
+		const size_t j = (size_t)(mt_rand(&rng)*(double)(i+1));
+		const uint32_t t = lab[i];
+		lab[i] = lab[j];
+		lab[j] = t;
+	}
+	size_t m = 0;
+	for (size_t i=0; i<N; ++i) {
+		for (size_t k=1; k<=K; ++k) {
+			const size_t j = mt_rand(&rng) < prew ? (size_t)(mt_rand(&rng)*(double)N)%N : (i+k)%N;
+			const double wij = 0.5+mt_rand(&rng);
+			row[m] = lab[i]; col[m] = lab[j]; w[m] = wij; ++m;
+			row[m] = lab[j]; col[m] = lab[i]; w[m] = wij; ++m;
+		}
+	}
+	for (size_t i=0; i<N; ++i) {
+		b[i]  = 0.1*mt_randn(&rng);
+		x0[i] = mt_randn(&rng);
+	}
+	const edges_t E = {.N = N, .nnz = nnz, .row = row, .col = col, .w = w};
+
+	onet_t W;
+	if (onet_build(&W,N,nnz,row,col,w) != 0) {
+		perror("ERROR: Failed to build network");
+		return EXIT_FAILURE;
+	}
+	printf("connections: %zu, bandwidth %zu\n",nnz,onet_bandwidth(&W));
+
+	// Time coupling RHS
+
+	const int nrep = 50;
+	double t, tnaive, tcsr, trcm, tsell;
+	t = wtime();
+	for (int r=0; r<nrep; ++r) netnaive(y,x0,&E,b,g);
+	tnaive = (wtime()-t)/nrep;
+	t = wtime();
+	for (int r=0; r<nrep; ++r) netspmv(z,x0,&W,b,g);
+	tcsr = (wtime()-t)/nrep;
+	double err = 0.0;
+	for (size_t i=0; i<N; ++i) if (fabs(z[i]-y[i]) > err) err = fabs(z[i]-y[i]);
+
+	if (onet_rcm(&W,perm) != 0 || onet_permute(&W,perm) != 0) {
+		perror("ERROR: Failed to reorder network");
+		return EXIT_FAILURE;
+	}
+	printf("RCM reordered: bandwidth %zu\n\n",onet_bandwidth(&W));
+	onet_gather(x,x0,perm,N);
+	onet_gather(bp,b,perm,N);
+	t = wtime();
+	for (int r=0; r<nrep; ++r) netspmv(z,x,&W,bp,g);
+	trcm = (wtime()-t)/nrep;
+	if (onet_sell(&W,sigma) != 0) {
+		perror("ERROR: Failed to build SELL-C-sigma storage");
+		return EXIT_FAILURE;
+	}
+	printf("SELL-C-sigma: %zu stored (%.1f%% padding)\n\n",W.cp[W.nch],100.0*(double)(W.cp[W.nch]-nnz)/(double)nnz);
+	t = wtime();
+	for (int r=0; r<nrep; ++r) netspmv(z,x,&W,bp,g);
+	tsell = (wtime()-t)/nrep;
+	onet_scatter(x,z,perm,N);
+	for (size_t i=0; i<N; ++i) if (fabs(x[i]-y[i]) > err) err = fabs(x[i]-y[i]);
+
+	printf("RHS evaluation          time (ms)   ns/connection   speedup\n");
+	printf("naive edge list         %9.3f   %13.3f   %7.2f\n",1e3*tnaive,1e9*tnaive/(double)nnz,1.0);
+	printf("CSR                     %9.3f   %13.3f   %7.2f\n",1e3*tcsr,  1e9*tcsr  /(double)nnz,tnaive/tcsr);
+	printf("CSR, RCM                %9.3f   %13.3f   %7.2f\n",1e3*trcm,  1e9*trcm  /(double)nnz,tnaive/trcm);
+	printf("SELL-C-sigma, RCM       %9.3f   %13.3f   %7.2f\n",1e3*tsell, 1e9*tsell /(double)nnz,tnaive/tsell);
+	printf("max. difference %.2e\n\n",err);
+
+	// Integrate (RK4), naive and SpMV RHS
+
+	const ode_t solver = RKFOUR;
+	memcpy(y,x0,N*sizeof(double));
+	t = wtime();
+	for (size_t k=0; k<n; ++k) ODESTEP(solver,netnaive,y,N,h,&E,b,g);
+	tnaive = wtime()-t;
+	onet_gather(x,x0,perm,N);
+	t = wtime();
+	for (size_t k=0; k<n; ++k) ODESTEP(solver,netspmv,x,N,h,&W,bp,g);
+	tsell = wtime()-t;
+	onet_scatter(z,x,perm,N);
+	err = 0.0;
+	for (size_t i=0; i<N; ++i) if (fabs(z[i]-y[i]) > err) err = fabs(z[i]-y[i]);
+	printf("RK4, %zu steps: naive %.3f s, SELL-C-sigma/RCM %.3f s (speedup %.2f); max. difference %.2e\n\n",n,tnaive,tsell,tnaive/tsell,err);
+
+	// Asymmetric (directed) networks: RCM must still give a permutation
+
+	onet_free(&W);
+	const uint32_t row3[2] = {1,2}, col3[2] = {0,1};
+	const double w3[2] = {1.0,1.0};
+	for (size_t k=0; k<nnz/2; ++k) { // keep edge i -> j of each pair (in place)
+		row[k] = row[2*k];
+		col[k] = col[2*k];
+		w[k]   = w[2*k];
+	}
+	int isperm = 1;
+	for (int c=0; c<2; ++c) { // 3-node chain, and the small-world network with one direction of each edge
+		const size_t Nc = c == 0 ? 3 : N;
+		if ((c == 0 ? onet_build(&W,3,2,row3,col3,w3) : onet_build(&W,N,nnz/2,row,col,w)) != 0 || onet_rcm(&W,perm) != 0) {
+			perror("ERROR: Failed to reorder network");
+			return EXIT_FAILURE;
+		}
+		memset(lab,0,Nc*sizeof(uint32_t));
+		for (size_t i=0; i<Nc; ++i) {
+			if (perm[i] >= Nc || lab[perm[i]]) isperm = 0;
+			else lab[perm[i]] = 1;
+		}
+		onet_free(&W);
+	}
+	printf("directed networks: RCM ordering is %sa permutation\n\n",isperm ? "" : "NOT ");
+
+	free(z);
+	free(y);
+	free(x);
+	free(x0);
+	free(bp);
+	free(b);
+	free(perm);
+	free(lab);
+	free(w);
+	free(col);
+	free(row);
+
+	return EXIT_SUCCESS;
+}
+
+// Kuramoto model, direct O(N^2) RHS (for comparison with okur_rhs)
+
+static inline void kuramoto(double* const xdot, const double* const x, const size_t N, const double* const omega, const double K)
+{
+	for (size_t i=0; i<N; ++i) {
+		double s = 0.0;
+		for (size_t j=0; j<N; ++j) s += sin(x[j]-x[i]);
+		xdot[i] = omega[i]+K*s/(double)N;
+	}
+}
+
+// Kuramoto model with Lorentzian (Cauchy) natural frequencies of width gam: the mean-field O(N) RHS is
+// checked and timed against the direct O(N^2) RHS, then a large population is integrated, and the
+// stationary order parameter compared with the analytic value R = sqrt(1-2 gam/K) (K > 2 gam,
+// N -> infinity).
+
+int kurtest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t N   = argc > 1 ? (size_t)atol(argv[1]) : 100000; // number of oscillators
+	const double K   = argc > 2 ?         atof(argv[2]) : 4.0;    // coupling strength
+	const double gam = argc > 3 ?         atof(argv[3]) : 1.0;    // frequency distribution width
+	const double h   = argc > 4 ?         atof(argv[4]) : 0.05;   // integration step size
+	const size_t n   = argc > 5 ? (size_t)atol(argv[5]) : 1000;   // number of integration time steps
+	const size_t Nd  = argc > 6 ? (size_t)atol(argv[6]) : 2000;   // number of oscillators for direct RHS
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (Kuramoto model) ***\n\n");
+	printf("number of oscillators       =  %zu\n",N);
+	printf("coupling strength           =  %g\n", K);
+	printf("frequency width             =  %g\n", gam);
+	printf("integration step size       =  %g\n", h);
+	printf("number of integration steps =  %zu\n",n);
+	printf("oscillators for direct RHS  =  %zu\n\n",Nd);
+
+	const size_t Nm = N > Nd ? N : Nd;
+	double* const omega = malloc(Nm*sizeof(double));
+	double* const x     = malloc(Nm*sizeof(double));
+	double* const y     = malloc(Nm*sizeof(double));
+	double* const z     = malloc(Nm*sizeof(double));
+	if (omega == NULL || x == NULL || y == NULL || z == NULL) {
+		perror("ERROR: Failed to allocate oscillators");
+		return EXIT_FAILURE;
+	}
+	mt_t rng;
+	mt_seed(&rng,2468);
+	for (size_t i=0; i<Nm; ++i) {
+		omega[i] = gam*tan(M_PI*((double)i+0.5)/(double)Nm-M_PI/2.0); // deterministic Lorentzian quantiles
+		x[i] = 2.0*M_PI*mt_rand(&rng);
+	}
+
+	// Direct vs mean-field RHS
+
+	okur_t k;
+	if (okur_init(&k,Nd,omega,K,0.0) != 0) {
+		perror("ERROR: Failed to allocate oscillators");
+		return EXIT_FAILURE;
+	}
+	double t = wtime();
+	kuramoto(y,x,Nd,omega,K);
+	const double td = wtime()-t;
+	const int nrep = 100;
+	t = wtime();
+	for (int r=0; r<nrep; ++r) okur_rhs(z,x,&k);
+	const double tm = (wtime()-t)/nrep;
+	double err = 0.0;
+	for (size_t i=0; i<Nd; ++i) if (fabs(z[i]-y[i]) > err) err = fabs(z[i]-y[i]);
+	printf("RHS, N = %zu: direct %.3f ms, mean-field %.3f ms (speedup %.0f); max. difference %.2e\n\n",Nd,1e3*td,1e3*tm,td/tm,err);
+	okur_free(&k);
+
+	// Large population: stationary order parameter
+
+	if (okur_init(&k,N,omega,K,0.0) != 0) {
+		perror("ERROR: Failed to allocate oscillators");
+		return EXIT_FAILURE;
+	}
+	const ode_t solver = RKFOUR;
+	double Rm = 0.0;
+	size_t nm = 0;
+	t = wtime();
+	for (size_t j=0; j<n; ++j) {
+		ODESTEP(solver,okur_rhs,x,N,h,&k);
+		if (2*j >= n) { // average over second half
+			Rm += k.R;
+			++nm;
+		}
+	}
+	t = wtime()-t;
+	Rm /= (double)nm;
+	const double Ra = K > 2.0*gam ? sqrt(1.0-2.0*gam/K) : 0.0;
+	printf("RK4, %zu steps: %.3f s (%.2f ns/oscillator/step)\n",n,t,1e9*t/((double)N*(double)n));
+	printf("order parameter: mean %.6f, analytic %.6f (difference %.2e)\n\n",Rm,Ra,fabs(Rm-Ra));
+	okur_free(&k);
+
+	free(z);
+	free(y);
+	free(x);
+	free(omega);
+
+	return EXIT_SUCCESS;
+}
+
+// Correlated noise: covariance V_ij = rho^|i-j| factored once, increments generated in blocks; the
+// transform is timed against a per-step matrix-vector product, and the sample covariance checked.
+
+int noisetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t N   = argc > 1 ? (size_t)atol(argv[1]) : 32;      // number of variables
+	const size_t m   = argc > 2 ? (size_t)atol(argv[2]) : 1000000; // number of increments
+	const double rho = argc > 3 ?         atof(argv[3]) : 0.8;     // correlation parameter
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (correlated noise) ***\n\n");
+	printf("number of variables         =  %zu\n",N);
+	printf("number of increments        =  %zu\n",m);
+	printf("correlation parameter       =  %g\n\n",rho);
+
+	double* const V = malloc(N*N*sizeof(double));
+	double* const C = malloc(N*N*sizeof(double));
+	double* const z = malloc(N*m*sizeof(double));
+	double* const y = malloc(N*m*sizeof(double));
+	if (V == NULL || C == NULL || z == NULL || y == NULL) {
+		perror("ERROR: Failed to allocate noise");
+		return EXIT_FAILURE;
+	}
+	for (size_t i=0; i<N; ++i) {
+		for (size_t j=0; j<N; ++j) V[N*i+j] = pow(rho,fabs((double)i-(double)j));
+	}
+	onoise_t c;
+	if (onoise_init(&c,N,V) != 0) {
+		perror("ERROR: Failed to factor covariance matrix");
+		return EXIT_FAILURE;
+	}
+	mt_t rng;
+	mt_seed(&rng,1357);
+	for (size_t k=0; k<N*m; ++k) z[k] = mt_randn(&rng);
+
+	// Per-step matrix-vector product (lower-triangular L, row-major)
+
+	for (size_t i=0; i<N; ++i) {
+		for (size_t j=0; j<N; ++j) C[N*i+j] = j <= i ? c.U[N*j+i] : 0.0;
+	}
+	double t = wtime();
+	for (size_t k=0; k<m; ++k) {
+		const double* const zk = z+N*k;
+		double* const yk = y+N*k;
+		for (size_t i=0; i<N; ++i) {
+			double s = 0.0;
+			for (size_t j=0; j<=i; ++j) s += C[N*i+j]*zk[j];
+			yk[i] = s;
+		}
+	}
+	const double tmv = wtime()-t;
+
+	// Blocked, in place
+
+	t = wtime();
+	onoise_apply(&c,z,m,1.0);
+	const double tbl = wtime()-t;
+	double err = 0.0;
+	for (size_t k=0; k<N*m; ++k) if (fabs(z[k]-y[k]) > err) err = fabs(z[k]-y[k]);
+	printf("transform: per-step %.3f s, blocked %.3f s (speedup %.2f); max. difference %.2e\n",tmv,tbl,tmv/tbl,err);
+
+	ocov_t cv;
+	if (ocov_init(&cv,N) != 0) {
+		perror("ERROR: Failed to allocate covariance accumulator");
+		return EXIT_FAILURE;
+	}
+	for (size_t k=0; k<m; ++k) ocov_update(&cv,z+N*k);
+	ocov_cov(&cv,C);
+	double cerr = 0.0;
+	for (size_t k=0; k<N*N; ++k) if (fabs(C[k]-V[k]) > cerr) cerr = fabs(C[k]-V[k]);
+	printf("sample covariance: max. abs. error %.2e (expected ~%.1e)\n\n",cerr,3.0*sqrt(2.0/(double)m));
+	ocov_free(&cv);
+
+	onoise_free(&c);
+	free(y);
+	free(z);
+	free(C);
+	free(V);
+
+	return EXIT_SUCCESS;
+}
+
+// Coloured noise: OU noise (exact recursion) checked for stationary variance and lag-one
+// autocorrelation; 1/f noise (sum of OU processes) spectrum estimated (Welch) and log-log slope fitted
+// within the design band; then an OU process driven by 1/f noise is integrated, with the noise generated
+// alongside, and its mean square compared with the stationary variance.
+
+static inline void pinkdriven(double* const xdot, const double* const x, const double a, const double* const u)
+{
+	xdot[0] = -a*x[0]+u[0];
+}
+
+int colourtest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double h     = argc > 1 ?         atof(argv[1]) : 0.01;    // integration step size
+	const size_t n     = argc > 2 ? (size_t)atol(argv[2]) : 1000000; // number of integration time steps
+	const double tau   = argc > 3 ?         atof(argv[3]) : 0.5;     // OU time constant
+	const double alpha = argc > 4 ?         atof(argv[4]) : 1.0;     // 1/f exponent
+	const size_t K     = argc > 5 ? (size_t)atol(argv[5]) : 8;       // OU processes for 1/f noise
+	const size_t L     = argc > 6 ? (size_t)atol(argv[6]) : 65536;   // Welch window length
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (coloured noise) ***\n\n");
+	printf("integration step size       =  %g\n",h);
+	printf("number of integration steps =  %zu\n",n);
+	printf("OU time constant            =  %g\n",tau);
+	printf("1/f exponent                =  %g\n",alpha);
+	printf("OU processes for 1/f noise  =  %zu\n",K);
+	printf("Welch window length         =  %zu\n\n",L);
+
+	mt_t rng;
+	mt_seed(&rng,97531);
+
+	// OU noise
+
+	ocn_t c;
+	double z0 = mt_randn(&rng);
+	if (ocn_ou(&c,1,tau,1.0,h,&z0) != 0) {
+		perror("ERROR: Failed to allocate noise");
+		return EXIT_FAILURE;
+	}
+	double s1 = 0.0, s2 = 0.0, s11 = 0.0, u0 = c.u[0];
+	double t = wtime();
+	for (size_t k=0; k<n; ++k) {
+		const double z = mt_randn(&rng);
+		const double u = ocn_step(&c,&z)[0];
+		s1  += u;
+		s2  += u*u;
+		s11 += u*u0;
+		u0   = u;
+	}
+	t = wtime()-t;
+	const double m1 = s1/(double)n, v = s2/(double)n-m1*m1;
+	printf("OU: variance %.4f (1), lag-one autocorrelation %.6f (%.6f); %.2f ns/step\n\n",v,(s11/(double)n-m1*m1)/v,exp(-h/tau),1e9*t/(double)n);
+	ocn_free(&c);
+
+	// 1/f noise: spectrum, design band [1/(2 pi taumax), 1/(2 pi taumin)]
+
+	const double taumin = 10.0*h, taumax = 1e4*h;
+	double zk[K];
+	for (size_t k=0; k<K; ++k) zk[k] = mt_randn(&rng);
+	owelch_t w;
+	if (ocn_pink(&c,1,alpha,taumin,taumax,K,1.0,h,zk) != 0 || owelch_init(&w,1,L,L/2,h) != 0) {
+		perror("ERROR: Failed to allocate noise");
+		return EXIT_FAILURE;
+	}
+	for (size_t k=0; k<n; ++k) {
+		for (size_t j=0; j<K; ++j) zk[j] = mt_randn(&rng);
+		owelch_update(&w,ocn_step(&c,zk));
+	}
+	double* const psd = malloc(w.nf*sizeof(double));
+	if (psd == NULL) {
+		perror("ERROR: Failed to allocate PSD");
+		return EXIT_FAILURE;
+	}
+	owelch_psd(&w,psd);
+	const double f0 = 2.0/(2.0*M_PI*taumax), f1 = 0.5/(2.0*M_PI*taumin);
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+	size_t nb = 0;
+	for (size_t k=1; k<w.nf; ++k) {
+		const double f = owelch_freq(&w,k);
+		if (f < f0 || f > f1) continue;
+		const double lx = log(f), ly = log(psd[k]);
+		sx += lx; sy += ly; sxx += lx*lx; sxy += lx*ly;
+		++nb;
+	}
+	const double slope = ((double)nb*sxy-sx*sy)/((double)nb*sxx-sx*sx);
+	printf("1/f noise: log-log PSD slope %.3f (%.3f) over [%.3g,%.3g] (%zu bins, %zu segments)\n\n",slope,-alpha,f0,f1,nb,w.nseg);
+	free(psd);
+	owelch_free(&w);
+
+	// OU process driven by 1/f noise, noise generated alongside integration
+
+	const ode_t solver = HEUN;
+	const double a = 1.0;
+	double x = 0.0, sx2 = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		for (size_t j=0; j<K; ++j) zk[j] = mt_randn(&rng);
+		ocn_step(&c,zk);
+		ODESTEP(solver,pinkdriven,(&x),1,h,a,c.u);
+		sx2 += x*x;
+	}
+	double vx = 0.0; // stationary variance: sum over OU components, s^2/(a(a+1/tau))
+	for (size_t k=0; k<K; ++k) {
+		const double tk = -h/log(c.a[k]), sk = c.b[k]/sqrt(1.0-c.a[k]*c.a[k]);
+		vx += sk*sk/(a*(a+1.0/tk));
+	}
+	printf("driven OU process: mean square %.4f (%.4f)\n\n",sx2/(double)n,vx);
+	ocn_free(&c);
+
+	return EXIT_SUCCESS;
+}
+
+// Jump-diffusion: OU process with additive shot noise (Poisson jumps with exponentially distributed
+// amplitudes of mean A); stationary mean and variance are compared with theory, lam A/a and
+// sig^2/(2a) + lam A^2/a, and the cost compared with per-step Bernoulli jump tests.
+
+static double jumpunif(void* const rng)
+{
+	return mt_rand(rng);
+}
+
+typedef struct {
+	mt_t*  rng; // generator
+	double A;   // mean jump amplitude
+} shot_t;
+
+static void shot(double* const x, const double t, void* const arg)
+{
+	(void)t;
+	const shot_t* const s = arg;
+	x[0] += -s->A*log(1.0-mt_rand(s->rng));
+}
+
+int jumptest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double a   = argc > 1 ?         atof(argv[1]) : 1.0;      // OU decay parameter
+	const double sig = argc > 2 ?         atof(argv[2]) : 0.5;      // OU noise intensity
+	const double lam = argc > 3 ?         atof(argv[3]) : 2.0;      // jump rate
+	const double A   = argc > 4 ?         atof(argv[4]) : 0.3;      // mean jump amplitude
+	const double h   = argc > 5 ?         atof(argv[5]) : 0.01;     // integration step size
+	const size_t n   = argc > 6 ? (size_t)atol(argv[6]) : 10000000; // number of integration time steps
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (jump-diffusion) ***\n\n");
+	printf("OU decay parameter          =  %g\n",a);
+	printf("OU noise intensity          =  %g\n",sig);
+	printf("jump rate                   =  %g\n",lam);
+	printf("mean jump amplitude         =  %g\n",A);
+	printf("integration step size       =  %g\n",h);
+	printf("number of integration steps =  %zu\n\n",n);
+
+	mt_t rng;
+	mt_seed(&rng,8642);
+	const ode_t solver = RKFOUR;
+	const double ssig = sig*sqrt(h);
+	shot_t sh = {.rng = &rng, .A = A};
+	const double mth = lam*A/a, vth = sig*sig/(2.0*a)+lam*A*A/a;
+
+	// Exponential waiting times
+
+	ojump_t j;
+	ojump_init(&j,lam,0.0,jumpunif,&rng);
+	double x = 0.0, s1 = 0.0, s2 = 0.0;
+	double t = wtime();
+	for (size_t k=0; k<n; ++k) {
+		JDSTEP1(solver,ouproc,x,h,&j,shot,&sh,a);
+		x += ssig*mt_randn(&rng);
+		s1 += x;
+		s2 += x*x;
+	}
+	t = wtime()-t;
+	double m1 = s1/(double)n;
+	printf("waiting times: %zu jumps (expected %.0f); mean %.4f (%.4f), variance %.4f (%.4f); %.2f ns/step\n",
+		j.njump,lam*h*(double)n,m1,mth,s2/(double)n-m1*m1,vth,1e9*t/(double)n);
+
+	// Per-step Bernoulli tests (jumps at step ends)
+
+	const double pj = lam*h;
+	size_t nj = 0;
+	x = s1 = s2 = 0.0;
+	t = wtime();
+	for (size_t k=0; k<n; ++k) {
+		ODESTEP1(solver,ouproc,x,h,a);
+		if (mt_rand(&rng) < pj) {
+			shot(&x,0.0,&sh);
+			++nj;
+		}
+		x += ssig*mt_randn(&rng);
+		s1 += x;
+		s2 += x*x;
+	}
+	t = wtime()-t;
+	m1 = s1/(double)n;
+	printf("Bernoulli:     %zu jumps (expected %.0f); mean %.4f (%.4f), variance %.4f (%.4f); %.2f ns/step\n\n",
+		nj,lam*h*(double)n,m1,mth,s2/(double)n-m1*m1,vth,1e9*t/(double)n);
+
+	return EXIT_SUCCESS;
+}
+
+// Monte Carlo ensemble of an OU process: E[exp(x(T))] estimated by plain Monte Carlo, antithetic pairs,
+// control variates (x(T) and x(T)^2, with means known exactly for the discretised process), and both;
+// estimates are compared with the exact value (also for the discretised process: x(T) is Gaussian), and
+// estimators by variance x cost.
+
+static inline void ouvec(double* const xdot, const double* const x, const double a)
+{
+	xdot[0] = -a*x[0];
+}
+
+static double mcrandn(void* const rng)
+{
+	return mt_randn(rng);
+}
+
+static void mcq(double* const q, const double* const x, void* const arg) // arg: number of controls (0 or 2)
+{
+	q[0] = exp(x[0]);
+	if (*(const size_t*)arg > 0) {
+		q[1] = x[0];
+		q[2] = x[0]*x[0];
+	}
+}
+
+int mctest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double a   = argc > 1 ?         atof(argv[1]) : 1.0;   // OU decay parameter
+	const double sig = argc > 2 ?         atof(argv[2]) : 0.5;   // OU noise intensity
+	const double x0  = argc > 3 ?         atof(argv[3]) : 1.0;   // initial state
+	const double h   = argc > 4 ?         atof(argv[4]) : 0.01;  // integration step size
+	const size_t n   = argc > 5 ? (size_t)atol(argv[5]) : 101;   // number of integration time steps
+	const size_t m   = argc > 6 ? (size_t)atol(argv[6]) : 20000; // number of paths
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (Monte Carlo variance reduction) ***\n\n");
+	printf("OU decay parameter          =  %g\n",a);
+	printf("OU noise intensity          =  %g\n",sig);
+	printf("initial state               =  %g\n",x0);
+	printf("integration step size       =  %g\n",h);
+	printf("number of integration steps =  %zu\n",n);
+	printf("number of paths             =  %zu\n\n",m);
+
+	// Exact moments of the discretised (RK4 drift, additive noise) process
+
+	const ode_t solver = RKFOUR;
+	const double ah = a*h, R = 1.0-ah+ah*ah/2.0-ah*ah*ah/6.0+ah*ah*ah*ah/24.0;
+	double M = x0, V = 0.0;
+	for (size_t k=1; k<n; ++k) {
+		M = R*M;
+		V = R*R*V+sig*sig*h;
+	}
+	const double exact = exp(M+V/2.0), mu[2] = {M,V+M*M};
+	printf("exact E[exp(x(T))] = %.8f\n\n",exact);
+
+	// Plain, antithetic (same number of paths), control variates, both
+
+	const char* const names[4] = {"plain","antithetic","control variates","antithetic + control"};
+	double vc0 = 0.0;
+	printf("estimator                  estimate    std. err.    z      paths  variates   time (s)   var x time   gain\n");
+	for (int c=0; c<4; ++c) {
+		const int anti = c & 1;
+		const size_t P = c & 2 ? 2 : 0;
+		mt_t rng;
+		mt_seed(&rng,1111);
+		omc_t mc;
+		if (omc_init(&mc,P,mu,anti,mcrandn,&rng) != 0) {
+			perror("ERROR: Failed to allocate Monte Carlo accumulator");
+			return EXIT_FAILURE;
+		}
+		OMCSDE(solver,ouvec,1,h,n,(&x0),(&sig),anti ? m/2 : m,&mc,mcq,(void*)&P,a);
+		double est, se, vc;
+		omc_result(&mc,&est,&se,&vc);
+		if (c == 0) vc0 = vc;
+		printf("%-22s %12.8f %12.3e %6.2f %8zu %9zu %10.4f %12.3e %7.1f\n",names[c],est,se,(est-exact)/se,mc.npath,mc.nrand,mc.time,vc,vc0/vc);
+		omc_free(&mc);
+	}
+	putchar('\n');
+
+	return EXIT_SUCCESS;
+}
+
+// Quasi-Monte Carlo ensembles: (1) Lorenz 96 with uniformly perturbed initial conditions, ensemble mean
+// of (1/N) sum x_i(T)^2 (short T, smooth in the initial conditions; reference value from a larger Sobol
+// ensemble); (2) OU process, E[exp(x(T))] with Sobol noise by Brownian bridge (exact value known for the
+// discretised process). RMS errors over R
+// independent replications (pseudo-random seeds, or Sobol scrambles) are compared, for ensemble sizes
+// M = 2^k (prefixes of the same sequences; the Sobol chunk after the first half is generated after a
+// Gray-code skip, as a parallel chunk would be).
+
+int qmctest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t N    = argc > 1 ? (size_t)atol(argv[1]) : 8;    // Lorenz 96 dimension
+	const double T    = argc > 2 ?         atof(argv[2]) : 0.2;  // Lorenz 96 integration time
+	const size_t n    = argc > 3 ? (size_t)atol(argv[3]) : 32;   // OU integration time steps (Brownian bridge dimension)
+	const unsigned kmax = argc > 4 ? (unsigned)atoi(argv[4]) : 14; // maximum ensemble size 2^kmax
+	const size_t R    = argc > 5 ? (size_t)atol(argv[5]) : 16;   // number of replications
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (quasi-Monte Carlo ensembles) ***\n\n");
+	printf("Lorenz 96 dimension         =  %zu\n",N);
+	printf("Lorenz 96 integration time  =  %g\n",T);
+	printf("OU integration time steps   =  %zu\n",n);
+	printf("maximum ensemble size       =  2^%u\n",kmax);
+	printf("replications                =  %zu\n\n",R);
+
+	if (N < 4) {
+		fprintf(stderr,"ERROR: Lorenz 96 needs at least four variables\n");
+		return EXIT_FAILURE;
+	}
+
+	const ode_t solver = RKFOUR;
+	const size_t Mmax = (size_t)1<<kmax;
+	double* const est = malloc(2*2*R*(kmax+1)*sizeof(double)); // [problem][method][replication][k]
+	double* const z   = malloc((N > n ? N : n)*sizeof(double));
+	double* const dw  = malloc(n*sizeof(double));
+	obb_t bb;
+	if (est == NULL || z == NULL || dw == NULL || obb_init(&bb,n,1.0/(double)n) != 0) {
+		perror("ERROR: Failed to allocate");
+		return EXIT_FAILURE;
+	}
+	const double F = 8.0, hl = 0.01;
+	const size_t nl = (size_t)(T/hl+0.5);
+	const double a = 1.0, sig = 0.5, x0 = 1.0, ho = 1.0/(double)n;
+
+	// Exact OU E[exp(x(T))] for the discretised process, T = 1
+
+	const double ah = a*ho, Rk = 1.0-ah+ah*ah/2.0-ah*ah*ah/6.0+ah*ah*ah*ah/24.0;
+	double Mo = x0, Vo = 0.0;
+	for (size_t k=0; k<n; ++k) {
+		Mo = Rk*Mo;
+		Vo = Rk*Rk*Vo+sig*sig*ho;
+	}
+	const double exact = exp(Mo+Vo/2.0);
+
+	for (size_t r=0; r<R; ++r) {
+		for (int q=0; q<2; ++q) { // method: pseudo-random, Sobol
+			mt_t rng;
+			mt_seed(&rng,1000+r);
+			osobol_t sl, so;
+			if (osobol_init(&sl,N,2000+r) != 0 || osobol_init(&so,n,3000+r) != 0) {
+				perror("ERROR: Failed to allocate Sobol generator");
+				return EXIT_FAILURE;
+			}
+			double sum[2] = {0.0,0.0};
+			unsigned k = 0;
+			for (size_t m=0; m<Mmax; ++m) {
+				if (q == 1 && m == Mmax/2) { // second half as a separate chunk
+					osobol_skip(&sl,m);
+					osobol_skip(&so,m);
+				}
+
+				// Lorenz 96 from perturbed initial conditions
+
+				double x[N];
+				if (q == 0) for (size_t i=0; i<N; ++i) z[i] = mt_rand(&rng);
+				else osobol_next(&sl,z);
+				for (size_t i=0; i<N; ++i) x[i] = F+2.0*z[i]-1.0;
+				for (size_t j=0; j<nl; ++j) ODESTEP(solver,lorenz96,x,N,hl,N,F);
+				double e = 0.0;
+				for (size_t i=0; i<N; ++i) e += x[i]*x[i];
+				sum[0] += e/(double)N;
+
+				// OU process
+
+				if (q == 0) for (size_t j=0; j<n; ++j) dw[j] = sig*sqrt(ho)*mt_randn(&rng);
+				else {
+					osobol_normal(&so,z);
+					obb_noise(&bb,1,z,dw,sig);
+				}
+				double y = x0;
+				for (size_t j=0; j<n; ++j) {
+					ODESTEP1(solver,ouproc,y,ho,a);
+					y += dw[j];
+				}
+				sum[1] += exp(y);
+
+				if (m+1 == (size_t)1<<k) {
+					for (int p=0; p<2; ++p) est[((size_t)(2*p+q)*R+r)*(kmax+1)+k] = sum[p]/(double)(m+1);
+					++k;
+				}
+			}
+			osobol_free(&so);
+			osobol_free(&sl);
+		}
+	}
+
+	// Lorenz 96 reference: separate Sobol scramble, 4 x the largest ensemble size
+
+	double ref = 0.0;
+	osobol_t sr;
+	if (osobol_init(&sr,N,9999) != 0) {
+		perror("ERROR: Failed to allocate Sobol generator");
+		return EXIT_FAILURE;
+	}
+	for (size_t m=0; m<4*Mmax; ++m) {
+		double x[N];
+		osobol_next(&sr,z);
+		for (size_t i=0; i<N; ++i) x[i] = F+2.0*z[i]-1.0;
+		for (size_t j=0; j<nl; ++j) ODESTEP(solver,lorenz96,x,N,hl,N,F);
+		double e = 0.0;
+		for (size_t i=0; i<N; ++i) e += x[i]*x[i];
+		ref += e/(double)N;
+	}
+	ref /= (double)(4*Mmax);
+	osobol_free(&sr);
+
+	// RMS errors
+	printf("Lorenz 96 reference %.8f, OU exact %.8f\n\n",ref,exact);
+	printf("            Lorenz 96 RMS error             OU RMS error\n");
+	printf("       M    pseudo-random     Sobol       pseudo-random     Sobol\n");
+	for (unsigned k=4; k<=kmax; k += 2) {
+		double rms[4] = {0.0,0.0,0.0,0.0};
+		for (size_t c=0; c<4; ++c) {
+			const double v = c < 2 ? ref : exact;
+			for (size_t r=0; r<R; ++r) {
+				const double d = est[(c*R+r)*(kmax+1)+k]-v;
+				rms[c] += d*d;
+			}
+			rms[c] = sqrt(rms[c]/(double)R);
+		}
+		printf("%8zu %14.3e %12.3e %16.3e %12.3e\n",(size_t)1<<k,rms[0],rms[1],rms[2],rms[3]);
+	}
+	putchar('\n');
+
+	obb_free(&bb);
+	free(dw);
+	free(z);
+	free(est);
+
+	return EXIT_SUCCESS;
+}
+
+// Brownian tree: (1) consistency (same values for any query order and refinement) and increment
+// statistics; (2) strong convergence of Euler-Maruyama for an OU process as the step is refined on the
+// same noise paths; (3) adaptive step-doubling Euler-Maruyama for dx = -a x^3 dt + sig dW from a large
+// initial state (fast transient), with rejected steps retried on the same path, against a fine fixed-step
+// reference on that path.
+
+static inline void cubicdrift(double* const xdot, const double* const x, const double a)
+{
+	xdot[0] = -a*x[0]*x[0]*x[0];
+}
+
+int btreetest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const double T   = argc > 1 ?         atof(argv[1]) : 1.0;  // integration time
+	const double a   = argc > 2 ?         atof(argv[2]) : 1.0;  // drift parameter
+	const double sig = argc > 3 ?         atof(argv[3]) : 0.5;  // noise intensity
+	const size_t R   = argc > 4 ? (size_t)atol(argv[4]) : 200;  // number of paths
+	const double tol = argc > 5 ?         atof(argv[5]) : 1e-9; // tree resolution
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (Brownian tree) ***\n\n");
+	printf("integration time            =  %g\n",T);
+	printf("drift parameter             =  %g\n",a);
+	printf("noise intensity             =  %g\n",sig);
+	printf("number of paths             =  %zu\n",R);
+	printf("tree resolution             =  %g\n\n",tol);
+
+	// Consistency and statistics
+
+	obt_t b, c;
+	if (obt_init(&b,2,0.0,T,tol,42) != 0 || obt_init(&c,2,0.0,T,tol,42) != 0) {
+		perror("ERROR: Failed to allocate Brownian tree");
+		return EXIT_FAILURE;
+	}
+	printf("tree depth %u, cache %zu bytes\n",b.L,((size_t)(b.L+1)*(3+2*b.N)+b.N)*sizeof(double));
+	const size_t nq = 1000;
+	double wf[nq][2], wb[nq][2]; // full-step increments: forward on b, backward on c
+	double dmax = 0.0;
+	for (size_t k=0; k<nq; ++k) { // forward on b, backward on c; full step vs two half steps
+		const double ta = T*(double)k/(double)nq, tb = T*(double)(k+1)/(double)nq, tm = 0.5*(ta+tb);
+		double w2[2], w3[2];
+		obt_incr(&b,ta,tb,wf[k]);
+		const double sa = T*(double)(nq-1-k)/(double)nq, sb = T*(double)(nq-k)/(double)nq;
+		obt_incr(&c,sa,sb,wb[nq-1-k]);
+		obt_incr(&c,ta,tm,w2);
+		obt_incr(&b,tm,tb,w3);
+		for (int i=0; i<2; ++i) dmax = fmax(dmax,fabs(wf[k][i]-(w2[i]+w3[i])));
+	}
+	double bmax = 0.0;
+	for (size_t k=0; k<nq; ++k) for (int i=0; i<2; ++i) bmax = fmax(bmax,fabs(wf[k][i]-wb[k][i]));
+	printf("full step vs. half steps (different query orders): max. difference %.2e\n",dmax);
+	printf("forward vs. backward queries (same intervals)    : max. difference %.2e\n",bmax);
+	obt_free(&c);
+	obt_free(&b);
+	double s1 = 0.0, s2 = 0.0, sT = 0.0;
+	const double h = 0.05*T;
+	size_t nzq = 0, nqq = 0;
+	double t = wtime();
+	for (size_t r=0; r<R*10; ++r) {
+		if (obt_init(&b,1,0.0,T,tol,1000+r) != 0) {
+			perror("ERROR: Failed to allocate Brownian tree");
+			return EXIT_FAILURE;
+		}
+		for (size_t k=0; k<20; ++k) {
+			double dw;
+			obt_incr(&b,(double)k*h,(double)(k+1)*h,&dw);
+			s1 += dw;
+			s2 += dw*dw;
+			++nqq;
+		}
+		double w;
+		obt_eval(&b,T,&w);
+		sT += w*w;
+		nzq += b.nz;
+		obt_free(&b);
+	}
+	t = wtime()-t;
+	printf("increments over h = %g: mean %.4f (0), variance %.5f (%.5f); var W(T) %.4f (%g)\n",h,s1/(double)(20*R*10),s2/(double)(20*R*10),h,sT/(double)(R*10),T);
+	printf("sequential increments: %.1f normal variates, %.2f us per increment\n\n",(double)nzq/(double)nqq,1e6*t/(double)nqq);
+
+	// Strong convergence of Euler-Maruyama (OU) under refinement on the same paths
+
+	const ode_t solver = EULER;
+	const unsigned kref = 12;
+	printf("OU, Euler-Maruyama: mean abs. error at T vs. refinement (reference 2^%u steps)\n",kref);
+	printf("   steps    error      ratio\n");
+	double err[7] = {0.0};
+	for (size_t r=0; r<R; ++r) {
+		if (obt_init(&b,1,0.0,T,tol,5000+r) != 0) {
+			perror("ERROR: Failed to allocate Brownian tree");
+			return EXIT_FAILURE;
+		}
+		double xr = 1.0;
+		const size_t nr = (size_t)1<<kref;
+		for (size_t k=0; k<nr; ++k) {
+			double dw;
+			ODESTEP1(solver,ouproc,xr,T/(double)nr,a);
+			obt_incr(&b,T*(double)k/(double)nr,T*(double)(k+1)/(double)nr,&dw);
+			xr += sig*dw;
+		}
+		for (unsigned j=0; j<7; ++j) {
+			const size_t ns = (size_t)16<<j;
+			double x = 1.0;
+			for (size_t k=0; k<ns; ++k) {
+				double dw;
+				ODESTEP1(solver,ouproc,x,T/(double)ns,a);
+				obt_incr(&b,T*(double)k/(double)ns,T*(double)(k+1)/(double)ns,&dw);
+				x += sig*dw;
+			}
+			err[j] += fabs(x-xr)/(double)R;
+		}
+		obt_free(&b);
+	}
+	for (unsigned j=0; j<7; ++j) printf("%8zu %10.3e %8.2f\n",(size_t)16<<j,err[j],j > 0 ? err[j-1]/err[j] : 0.0);
+	putchar('\n');
+
+	// Adaptive step-doubling Euler-Maruyama, dx = -a x^3 dt + sig dW, x(0) = 10
+
+	printf("adaptive Euler-Maruyama (step doubling), x' = -a x^3 + noise, x(0) = 10\n");
+	printf("  tolerance   steps   rejected   mean abs. error\n");
+	const double tols[4] = {1e-1,1e-2,1e-3,1e-4};
+	for (int q=0; q<4; ++q) {
+		double e = 0.0;
+		size_t nacc = 0, nrej = 0;
+		for (size_t r=0; r<R; ++r) {
+			if (obt_init(&b,1,0.0,T,tol,7000+r) != 0) {
+				perror("ERROR: Failed to allocate Brownian tree");
+				return EXIT_FAILURE;
+			}
+			double xr[1] = {10.0};
+			const size_t nr = (size_t)1<<kref;
+			for (size_t k=0; k<nr; ++k) {
+				double dw;
+				ODESTEP(solver,cubicdrift,xr,1,T/(double)nr,a);
+				obt_incr(&b,T*(double)k/(double)nr,T*(double)(k+1)/(double)nr,&dw);
+				xr[0] += sig*dw;
+			}
+			double x[1] = {10.0}, ts = 0.0, hs = 1e-3*T;
+			while (ts < T) {
+				if (ts+hs > T) hs = T-ts;
+				double y1[1] = {x[0]}, y2[1] = {x[0]}, dw1, dw2;
+				obt_incr(&b,ts,ts+0.5*hs,&dw1);
+				obt_incr(&b,ts+0.5*hs,ts+hs,&dw2);
+				ODESTEP(solver,cubicdrift,y1,1,hs,a); // one full step
+				y1[0] += sig*(dw1+dw2);
+				ODESTEP(solver,cubicdrift,y2,1,0.5*hs,a); // two half steps
+				y2[0] += sig*dw1;
+				ODESTEP(solver,cubicdrift,y2,1,0.5*hs,a);
+				y2[0] += sig*dw2;
+				const double d = fabs(y2[0]-y1[0]);
+				if (d <= tols[q]) {
+					x[0] = y2[0];
+					ts  += hs;
+					++nacc;
+				}
+				else {
+					++nrej;
+				}
+				hs *= fmin(2.0,fmax(0.2,0.9*sqrt(tols[q]/(d+1e-300)))); // error ~ h^2 for the drift
+			}
+			e += fabs(x[0]-xr[0])/(double)R;
+			obt_free(&b);
+		}
+		printf("%11.0e %8.1f %10.1f %14.3e\n",tols[q],(double)nacc/(double)R,(double)nrej/(double)R,e);
+	}
+	putchar('\n');
+
+	return EXIT_SUCCESS;
+}
+
+// Van der Pol oscillators, batched (lanes contiguous; parameter mu per lane)
+
+static void vdpbatch(double* const xdot, const double* const x, const double* const p, const size_t B, const size_t nl, void* const arg)
+{
+	(void)arg;
+	for (size_t l=0; l<nl; ++l) {
+		xdot[l]   = x[B+l];
+		xdot[B+l] = p[l]*(1.0-x[l]*x[l])*x[B+l]-x[l];
+	}
+}
+
+static void sqdecaybatch(double* const xdot, const double* const x, const double* const p, const size_t B, const size_t nl, void* const arg)
+{
+	(void)B;
+	(void)arg;
+	for (size_t l=0; l<nl; ++l) xdot[l] = -p[l]*x[l]*x[l];
+}
+
+static inline void vdp(double* const xdot, const double* const x, const double mu)
+{
+	xdot[0] = x[1];
+	xdot[1] = mu*(1.0-x[0]*x[0])*x[1]-x[0];
+}
+
+int enstest(int argc, char* argv[])
+{
+	// Default command-line parameters
+
+	const size_t M    = argc > 1 ? (size_t)atol(argv[1]) : 4096; // number of trajectories
+	const size_t B    = argc > 2 ? (size_t)atol(argv[2]) : 16;   // lanes per batch
+	const double mumx = argc > 3 ?         atof(argv[3]) : 10.0; // maximum mu
+	const double Tmax = argc > 4 ?         atof(argv[4]) : 20.0; // maximum integration time
+	const double rtol = argc > 5 ?         atof(argv[5]) : 1e-6; // relative tolerance
+
+	// Display command-line parameters
+
+	printf("\n*** ODESOLVE test (adaptive ensemble with lane refilling) ***\n\n");
+	printf("number of trajectories      =  %zu\n",M);
+	printf("lanes per batch             =  %zu\n",B);
+	printf("maximum mu                  =  %g\n",mumx);
+	printf("maximum integration time    =  %g\n",Tmax);
+	printf("relative tolerance          =  %g\n\n",rtol);
+
+	// Jobs: van der Pol, x' = y, y' = mu (1-x^2) y - x, random mu, initial state and end time
+
+	const size_t N = 2;
+	double* const X0   = malloc((4*N+2)*M*sizeof(double));
+	oens_status_t* const st = malloc(M*sizeof(oens_status_t));
+	if (X0 == NULL || st == NULL) {
+		perror("ERROR: Failed to allocate jobs");
+		return EXIT_FAILURE;
+	}
+	double* const Y[3] = {X0+N*M,X0+2*N*M,X0+3*N*M};
+	double* const mu   = X0+4*N*M;
+	double* const tend = mu+M;
+	mt_t rng;
+	mt_seed(&rng,2024);
+	for (size_t m=0; m<M; ++m) {
+		mu[m]       = 0.1+(mumx-0.1)*mt_rand(&rng);
+		tend[m]     = Tmax*(0.1+0.9*mt_rand(&rng));
+		X0[N*m]     = 4.0*mt_rand(&rng)-2.0;
+		X0[N*m+1]   = 4.0*mt_rand(&rng)-2.0;
+	}
+
+	// Single trajectories (B = 1), static batches, refilled batches
+
+	const char* const name[3] = {"single (B = 1)","static batches","refilled batches"};
+	printf("                     time (s)   steps/traj   rejected   batch steps   lane use\n");
+	double t1 = 0.0;
+	for (int c=0; c<3; ++c) {
+		oens_t e;
+		if (oens_init(&e,N,1,c == 0 ? 1 : B,rtol,1e-3*rtol) != 0) {
+			perror("ERROR: Failed to allocate ensemble integrator");
+			return EXIT_FAILURE;
+		}
+		e.refill = c == 2;
+		double t = wtime();
+		const size_t nfail = oens_run(&e,M,X0,mu,tend,Y[c],st,vdpbatch,NULL);
+		t = wtime()-t;
+		if (c == 0) t1 = t;
+		printf("%-18s %10.3f %12.1f %10.1f %13zu %9.1f%%",name[c],t,(double)(e.nacc+e.nrej)/(double)M,(double)e.nrej/(double)M,e.nbatch,100.0*(double)e.nact/(double)e.nlane);
+		if (c > 0) {
+			double dmax = 0.0;
+			for (size_t i=0; i<N*M; ++i) dmax = fmax(dmax,fabs(Y[c][i]-Y[0][i]));
+			printf("   speedup %.2f, max. diff. vs. single %g",t1/t,dmax);
+		}
+		putchar('\n');
+		if (nfail > 0) printf("WARNING: %zu trajectories not completed\n",nfail);
+		oens_free(&e);
+	}
+	putchar('\n');
+
+	// Accuracy: some trajectories against fixed-step RK4 (fine steps)
+
+	const ode_t solver = RKFOUR;
+	double emax = 0.0;
+	for (size_t m=0; m<M; m+=M/8+1) {
+		const size_t n = (size_t)(20000.0*tend[m]);
+		const double h = tend[m]/(double)n;
+		double x[2] = {X0[N*m],X0[N*m+1]};
+		for (size_t k=0; k<n; ++k) ODESTEP(solver,vdp,x,2,h,mu[m]);
+		for (size_t i=0; i<N; ++i) emax = fmax(emax,fabs(Y[2][N*m+i]-x[i])/(1.0+fabs(x[i])));
+	}
+	printf("max. relative error vs. RK4 reference (h = 5e-5) = %.2e\n\n",emax);
+
+	// Fast decay x' = -c x^2, x(0) = 1e90: large trial steps overflow (non-finite error estimate), and
+	// must be rejected and retried with smaller steps, not reported as divergence
+
+	oens_t e;
+	if (oens_init(&e,1,1,OENS_VEC,rtol,1e-3*rtol) != 0) {
+		perror("ERROR: Failed to allocate ensemble integrator");
+		return EXIT_FAILURE;
+	}
+	const double cs = 1.0, Ts = 1.0, xs0 = 1e90;
+	double xs1;
+	oens_status_t sts;
+	oens_run(&e,1,&xs0,&cs,&Ts,&xs1,&sts,sqdecaybatch,NULL);
+	const double xsx = 1.0/(1.0/xs0+cs*Ts);
+	printf("fast decay (x0 = %g): status %s, %zu accepted, %zu rejected, x(T) = %.10f (exact %.10f)\n\n",
+		xs0,sts == OENS_DONE ? "done" : "NOT DONE",e.nacc,e.nrej,xs1,xsx);
+	oens_free(&e);
+	if (sts != OENS_DONE || !(fabs(xs1-xsx) <= 1e-4*xsx)) {
+		fprintf(stderr,"ERROR: non-finite error estimates not retried\n");
+		return EXIT_FAILURE;
+	}
+
+	free(st);
+	free(X0);
+
+	return EXIT_SUCCESS;
+}
+
 // Main function
 
-static const int ntests = 2;
+static const int ntests = 24;
 
 int main(int argc, char* argv[])
 {
@@ -251,6 +2716,28 @@ int main(int argc, char* argv[])
 	switch (test) {
 		case 1 : return lorenz96test (argc-1,argv+1);
 		case 2 : return outest       (argc-1,argv+1);
+		case 3 : return statstest    (argc-1,argv+1);
+		case 4 : return spectest     (argc-1,argv+1);
+		case 5 : return corrtest     (argc-1,argv+1);
+		case 6 : return comptest     (argc-1,argv+1);
+		case 7 : return fmttest      (argc-1,argv+1);
+		case 8 : return slicetest    (argc-1,argv+1);
+		case 9 : return pyrtest      (argc-1,argv+1);
+		case 10: return prectest     (argc-1,argv+1);
+		case 11: return halftest     (argc-1,argv+1);
+		case 12: return forcetest    (argc-1,argv+1);
+		case 13: return drivetest    (argc-1,argv+1);
+		case 14: return ddetest      (argc-1,argv+1);
+		case 15: return liftest      (argc-1,argv+1);
+		case 16: return nettest      (argc-1,argv+1);
+		case 17: return kurtest      (argc-1,argv+1);
+		case 18: return noisetest    (argc-1,argv+1);
+		case 19: return colourtest   (argc-1,argv+1);
+		case 20: return jumptest     (argc-1,argv+1);
+		case 21: return mctest       (argc-1,argv+1);
+		case 22: return qmctest      (argc-1,argv+1);
+		case 23: return btreetest    (argc-1,argv+1);
+		case 24: return enstest      (argc-1,argv+1);
 	}
 	return EXIT_FAILURE; // shouldn't get here!
 }